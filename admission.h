@@ -0,0 +1,103 @@
+/* Layout of the admission page shared by runway -A and its clients.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILTY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/license/>.
+*/
+
+/* runway -A NAME runs the controllers and runway state as a server on the
+ * POSIX shared memory object NAME; clients map the same object and fly their
+ * aircraft through it without linking against runway.c.
+ *
+ * An aircraft first claims a free slot by moving its state from SLOT_FREE to
+ * SLOT_WAITING with a compare-and-swap, writes its process id into client,
+ * then posts an ADMISSION_ENTER request for the slot into the ring and waits
+ * for the state to change. The server
+ * answers with SLOT_GRANTED, filling in the runway and the time the aircraft
+ * waited, or with SLOT_DIVERTED. A granted client holds the runway for as long
+ * as it needs and posts ADMISSION_LEAVE; the server frees the slot once it has
+ * handled the leave. A diverted client frees its slot itself. Clients should
+ * not claim a slot once closed is set, and may give up waiting if the server
+ * process is gone. The server takes back the aircraft of a client process
+ * that has died, frees their slots and clears any runway they held; a
+ * second SIGINT or SIGTERM makes it do that for every client, diverting the
+ * waiting ones, and stop.
+ *
+ * The ring takes requests from any number of clients and is read by the
+ * server alone. A client claims position p by advancing tail, waits until
+ * the cell's seq is p, writes the request and publishes it by setting seq to
+ * p + 1; the server reads the cell once seq is head + 1 and hands it back for
+ * the next lap by setting seq to head + ADMISSION_RING.
+ *
+ * Both sides spin for a moment and then sleep on a futex in the page itself.
+ * The server sleeps on doorbell with sleeping set; a client that sees
+ * sleeping after posting a request bumps doorbell and wakes it. A client
+ * waiting for its answer ors SLOT_SLEEPING into its slot's state before
+ * sleeping on it, and the server wakes it only then.
+ */
+
+#ifndef RUNWAY_ADMISSION_H
+#define RUNWAY_ADMISSION_H
+
+#include <stdint.h>
+
+#define ADMISSION_MAGIC 0x31414452u  /* "RDA1" */
+#define ADMISSION_RING  4096         /* Request cells, a power of two */
+#define ADMISSION_SLOTS 4096         /* Aircraft in flight at once over all clients */
+
+#define ADMISSION_ENTER    1         /* the slot's aircraft has arrived and wants the runway */
+#define ADMISSION_LEAVE    2         /* the slot's aircraft has cleared the runway */
+#define ADMISSION_SHUTDOWN 3         /* stop once every aircraft in flight has cleared */
+
+#define SLOT_FREE     0u             /* nobody's */
+#define SLOT_WAITING  1u             /* claimed by a client, waiting for the server's answer */
+#define SLOT_GRANTED  2u             /* the aircraft may use the runway */
+#define SLOT_DIVERTED 3u             /* turned away by the holding stack, runway -H */
+#define SLOT_SLEEPING 0x80000000u    /* or'd into SLOT_WAITING while the client sleeps on it */
+
+typedef struct
+{
+  uint64_t seq;                // ring position the cell is ready for, see above
+  int32_t op;                  // ADMISSION_*
+  int32_t slot;                // the aircraft's slot
+  int32_t type;                // commercial (0), cargo (1) or emergency (2)
+  int32_t runway_ms;           // time the aircraft needs on the runway
+  int32_t fuel;                // seconds of fuel left, 0 for a random reserve
+  int32_t unused;
+} admission_request;
+
+typedef struct
+{
+  uint32_t state;              // SLOT_*, the futex the client sleeps on
+  int32_t runway;              // granted runway, from 0; -1 if refused at shutdown
+  int32_t direction;           // NORTH (0) or SOUTH (1) when it was granted, or -1
+  int32_t aircraft_id;         // the aircraft's number in the server's log, or -1
+  int64_t wait_ns;             // time it spent in the server's queue
+  int32_t client;              // process id of the client that claimed the slot
+  char unused[36];             // a cache line per slot
+} admission_slot;
+
+typedef struct
+{
+  uint32_t magic;              // ADMISSION_MAGIC once the page is set up
+  int32_t pid;                 // of the server
+  uint32_t closed;             // the server is shutting down and takes no new aircraft
+  uint32_t next_slot;          // where clients start looking for a free slot
+  uint64_t tail __attribute__((aligned(64))); // next ring position a client claims
+  uint64_t head __attribute__((aligned(64))); // next ring position the server reads
+  uint32_t doorbell;           // futex the server sleeps on
+  uint32_t sleeping;           // the server is asleep, or about to be
+  admission_request ring[ADMISSION_RING] __attribute__((aligned(64)));
+  admission_slot slot[ADMISSION_SLOTS] __attribute__((aligned(64)));
+} admission_page;
+
+#endif
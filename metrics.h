@@ -0,0 +1,60 @@
+/* Layout of the live metrics page shared by runway and runway-top.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILTY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/license/>.
+*/
+
+/* runway -M NAME publishes a snapshot of the simulation into the POSIX shared
+ * memory object NAME a few times a second. The page is a seqlock: seq is odd
+ * while the snapshot is being written, so a reader copies the page and keeps
+ * the copy only if seq was even and unchanged across the copy.
+ */
+
+#ifndef RUNWAY_METRICS_H
+#define RUNWAY_METRICS_H
+
+#include <stdint.h>
+
+#define METRICS_MAGIC   0x31574d52u  /* "RMW1" */
+#define METRICS_RUNWAYS 16           /* MAX_RUNWAYS */
+
+typedef struct
+{
+  int32_t on_runway[4];        // commercial, cargo, emergency, total
+  int32_t waiting[3];          // commercial, cargo, emergency
+  int32_t direction;           // NORTH (0) or SOUTH (1)
+  int32_t switching;           // direction switch in progress
+  int32_t on_break;            // controller on break
+  int32_t since_break;         // aircraft handled since the last break
+  int32_t assigned;            // aircraft ever assigned here
+} metrics_runway;
+
+typedef struct
+{
+  uint32_t magic;              // METRICS_MAGIC once the page is set up
+  uint32_t seq;                // odd while a snapshot is being written
+  int32_t pid;                 // of the publishing simulation
+  int32_t done;                // the simulation is over, this is the last snapshot
+  int32_t runways;
+  int32_t capacity;
+  int64_t sim_ns;              // simulated time
+  int64_t wall_ns;             // wall-clock time since the start
+  uint64_t admitted;           // aircraft that got the runway so far
+  double per_hour;             // ... per simulated hour
+  int64_t wait_ns[4];          // p50, p99, p999 and max wait over all aircraft
+  int32_t switches;
+  int32_t breaks;
+  metrics_runway runway[METRICS_RUNWAYS];
+} metrics_page;
+
+#endif
@@ -0,0 +1,428 @@
+/* Load generator for a runway admission server.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILTY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/license/>.
+*/
+
+/* Flies the aircraft of a text trace ("type delay runway_time" per line, as
+ * workload writes) through a server started with runway -A NAME. A pool of
+ * client threads takes the aircraft in arrival order: each waits until its
+ * aircraft is due, asks for the runway, holds it for the runway time once
+ * granted and leaves. It prints how long the round trip to the server took for
+ * the aircraft granted without waiting, and how long the others waited in the
+ * server's queue. The protocol is in admission.h; this is its reference
+ * client.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "admission.h"
+
+#define NSEC_PER_SEC  1000000000LL
+#define NSEC_PER_MSEC 1000000LL
+#define WAIT_TRIES    100        /* Times to look for the object before giving up, 0.1 s apart */
+#define SPIN_NS       20000      /* A client polls its slot this long before sleeping on it */
+#define ALIVE_MS      1000       /* A sleeping client checks this often that the server is still there */
+
+typedef struct
+{
+  int type;
+  int64_t due_ns;                // arrival, from the start of the run
+  int64_t runway_ns;
+  int64_t round_trip_ns;         // from posting the enter to seeing the answer
+  int64_t wait_ns;               // spent in the server's queue, as the server says
+  int64_t late_ns;               // how far behind its arrival time the enter was posted
+  uint32_t answer;               // SLOT_GRANTED or SLOT_DIVERTED
+} flight;
+
+static struct
+{
+  admission_page *page;
+  flight *flights;
+  int count;
+  int next;                      // next flight a client takes
+  int64_t epoch;
+  uint64_t rings;                // times a client woke the server
+  uint64_t sleeps;               // times a client slept on its slot
+} load;
+
+static int64_t monotonic_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void sleep_until(int64_t t)
+{
+  struct timespec ts = { t / NSEC_PER_SEC, t % NSEC_PER_SEC };
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+  }
+}
+
+static void futex_wait(uint32_t *word, uint32_t expected, const struct timespec *until)
+{
+  syscall(SYS_futex, word, FUTEX_WAIT_BITSET, expected, until, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static void futex_wake(uint32_t *word)
+{
+  syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/* claims a free slot, looking from where the last client to look started */
+static int slot_claim(void)
+{
+  admission_page *page = load.page;
+
+  for (;;) {
+    uint32_t start = __atomic_fetch_add(&page->next_slot, 1, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < ADMISSION_SLOTS; i++) {
+      int slot = (int)((start + i) % ADMISSION_SLOTS);
+      uint32_t expected = SLOT_FREE;
+
+      if (__atomic_compare_exchange_n(&page->slot[slot].state, &expected, SLOT_WAITING, 0,
+                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return slot;
+      }
+    }
+    sched_yield();
+  }
+}
+
+/*
+* Function: post
+* Parameters: op - ADMISSION_*
+*             slot - the aircraft's slot
+*             f - the aircraft, NULL unless op is ADMISSION_ENTER
+* Returns: void
+* Description: puts a request on the ring, waiting for room if the server has
+*              fallen a whole ring behind, and rings the doorbell if the server
+*              is asleep.
+ */
+static void post(int op, int slot, const flight *f)
+{
+  admission_page *page = load.page;
+  uint64_t pos = __atomic_load_n(&page->tail, __ATOMIC_RELAXED);
+  admission_request *cell;
+
+  for (;;) {
+    cell = &page->ring[pos & (ADMISSION_RING - 1)];
+    uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+    if (seq == pos) {
+      if (__atomic_compare_exchange_n(&page->tail, &pos, pos + 1, 0, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else {
+      if ((int64_t)(seq - pos) < 0) {
+        sched_yield();  // full: the cell still holds the request of the last lap
+      }
+      pos = __atomic_load_n(&page->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  cell->op = op;
+  cell->slot = slot;
+  cell->type = f != NULL ? f->type : 0;
+  cell->runway_ms = f != NULL ? (int32_t)(f->runway_ns / NSEC_PER_MSEC) : 0;
+  cell->fuel = 0;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&page->sleeping, __ATOMIC_SEQ_CST)) {
+    __atomic_fetch_add(&page->doorbell, 1, __ATOMIC_RELEASE);
+    futex_wake(&page->doorbell);
+    __atomic_fetch_add(&load.rings, 1, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+* Function: answer
+* Parameters: slot - slot whose enter has been posted
+* Returns: uint32_t - SLOT_GRANTED or SLOT_DIVERTED
+* Description: polls the slot for SPIN_NS, then marks it SLOT_SLEEPING and
+*              sleeps on it until the server answers. Exits if the server
+*              has gone away meanwhile.
+ */
+static uint32_t answer(int slot)
+{
+  uint32_t *state = &load.page->slot[slot].state;
+  int64_t spin_until = monotonic_ns() + SPIN_NS;
+  uint32_t s;
+
+  while ((s = __atomic_load_n(state, __ATOMIC_ACQUIRE)) == SLOT_WAITING) {
+    if (monotonic_ns() >= spin_until) {
+      break;
+    }
+  }
+  while ((s & ~SLOT_SLEEPING) == SLOT_WAITING) {
+    int64_t until = monotonic_ns() + ALIVE_MS * NSEC_PER_MSEC;
+    struct timespec ts = { until / NSEC_PER_SEC, until % NSEC_PER_SEC };
+
+    if (s == SLOT_WAITING
+        && !__atomic_compare_exchange_n(state, &s, SLOT_WAITING | SLOT_SLEEPING, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      continue;  // answered meanwhile; s has the answer
+    }
+    __atomic_fetch_add(&load.sleeps, 1, __ATOMIC_RELAXED);
+    futex_wait(state, SLOT_WAITING | SLOT_SLEEPING, &ts);
+    s = __atomic_load_n(state, __ATOMIC_ACQUIRE);
+    if ((s & ~SLOT_SLEEPING) == SLOT_WAITING && kill(load.page->pid, 0) != 0 && errno == ESRCH) {
+      printf("runway-load: the server has gone away\n");
+      exit(1);
+    }
+  }
+  return s;
+}
+
+/* flies aircraft until the trace runs out */
+static void *client(void *arg)
+{
+  (void)arg;
+
+  for (;;) {
+    int i = __atomic_fetch_add(&load.next, 1, __ATOMIC_RELAXED);
+    flight *f;
+    int slot;
+    int64_t posted;
+
+    if (i >= load.count) {
+      return NULL;
+    }
+    f = &load.flights[i];
+    sleep_until(load.epoch + f->due_ns);
+    if (__atomic_load_n(&load.page->closed, __ATOMIC_ACQUIRE)) {
+      printf("runway-load: the server has closed\n");
+      exit(1);
+    }
+    slot = slot_claim();
+    load.page->slot[slot].client = (int32_t)getpid();
+    posted = monotonic_ns();
+    f->late_ns = posted - (load.epoch + f->due_ns);
+    post(ADMISSION_ENTER, slot, f);
+    f->answer = answer(slot);
+    f->round_trip_ns = monotonic_ns() - posted;
+    f->wait_ns = load.page->slot[slot].wait_ns;
+    if (f->answer == SLOT_GRANTED) {
+      sleep_until(monotonic_ns() + f->runway_ns);
+      post(ADMISSION_LEAVE, slot, NULL);
+    } else {
+      __atomic_store_n(&load.page->slot[slot].state, SLOT_FREE, __ATOMIC_RELEASE);
+    }
+  }
+}
+
+/* reads a text trace, dividing its times by speedup. Returns the number of aircraft. */
+static int read_trace(FILE *in, double speedup)
+{
+  char line[256];
+  int cap = 0;
+  double due = 0.0;
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    int type;
+    double delay, runway_time;
+
+    if (sscanf(line, "%d %lf %lf", &type, &delay, &runway_time) != 3 || type < 0 || type > 2
+        || delay < 0 || runway_time < 0) {
+      continue;  // comments and blank lines
+    }
+    if (load.count == cap) {
+      cap = cap ? 2 * cap : 1024;
+      load.flights = realloc(load.flights, cap * sizeof(flight));
+      if (load.flights == NULL) {
+        printf("runway-load: out of memory for %d aircraft\n", cap);
+        exit(1);
+      }
+    }
+    due = due + delay / speedup;
+    memset(&load.flights[load.count], 0, sizeof(flight));
+    load.flights[load.count].type = type;
+    load.flights[load.count].due_ns = (int64_t)(due * NSEC_PER_SEC);
+    load.flights[load.count].runway_ns = (int64_t)(runway_time / speedup * NSEC_PER_SEC);
+    load.count = load.count + 1;
+  }
+  return load.count;
+}
+
+static int compare_ns(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* prints count, p50, p99, p999 and max of n times, sorting them, in the given unit */
+static void print_times(const char *label, int64_t *ns, int n, double unit)
+{
+  qsort(ns, n, sizeof(int64_t), compare_ns);
+  printf("  %-20s %10d", label, n);
+  if (n > 0) {
+    printf(" %9.3f %9.3f %9.3f %9.3f", ns[(int)(0.5 * (n - 1))] / unit, ns[(int)(0.99 * (n - 1))] / unit,
+           ns[(int)(0.999 * (n - 1))] / unit, ns[n - 1] / unit);
+  }
+  printf("\n");
+}
+
+static void usage(void)
+{
+  printf("Usage: runway-load [-c clients] [-x speedup] [-q] shared-memory-name [trace]\n"
+         "  Flies the aircraft of a text trace (default stdin) through a server started\n"
+         "  with runway -A NAME, using a pool of client threads (default 64). -x divides\n"
+         "  every arrival and runway time by speedup; -q stops the server afterwards.\n");
+}
+
+int main(int argc, char **argv)
+{
+  int clients = 64;
+  double speedup = 1.0;
+  int quit = 0;
+  int opt;
+  int fd = -1;
+  const char *name;
+  FILE *in = stdin;
+  pthread_t *tid;
+  int64_t *at_once, *queued, *late;
+  int n_at_once = 0, n_queued = 0, diverted = 0;
+  int64_t wall;
+
+  while ((opt = getopt(argc, argv, "c:x:qh")) != -1) {
+    if (opt == 'c' && atoi(optarg) > 0) {
+      clients = atoi(optarg);
+    } else if (opt == 'x' && atof(optarg) > 0) {
+      speedup = atof(optarg);
+    } else if (opt == 'q') {
+      quit = 1;
+    } else {
+      usage();
+      return opt == 'h' ? 0 : EINVAL;
+    }
+  }
+  if (optind != argc - 1 && optind != argc - 2) {
+    usage();
+    return EINVAL;
+  }
+  name = argv[optind];
+  if (optind == argc - 2 && strcmp(argv[optind + 1], "-") != 0
+      && (in = fopen(argv[optind + 1], "r")) == NULL) {
+    printf("runway-load: cannot open %s: %s\n", argv[optind + 1], strerror(errno));
+    return 1;
+  }
+  if (read_trace(in, speedup) == 0) {
+    printf("runway-load: no aircraft in the trace\n");
+    return 1;
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+
+  // the server may not have created the object yet
+  for (int tries = 0; fd < 0 && tries < WAIT_TRIES; tries++) {
+    fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+      sleep_until(monotonic_ns() + 100 * NSEC_PER_MSEC);
+    }
+  }
+  if (fd < 0) {
+    printf("runway-load: cannot open shared memory %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  load.page = mmap(NULL, sizeof(admission_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (load.page == MAP_FAILED) {
+    printf("runway-load: cannot map shared memory %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  while (__atomic_load_n(&load.page->magic, __ATOMIC_ACQUIRE) != ADMISSION_MAGIC) {
+    sleep_until(monotonic_ns() + 10 * NSEC_PER_MSEC);
+  }
+
+  tid = malloc(clients * sizeof(pthread_t));
+  if (tid == NULL) {
+    printf("runway-load: out of memory for %d clients\n", clients);
+    return 1;
+  }
+  load.epoch = monotonic_ns();
+  for (int i = 0; i < clients; i++) {
+    int result = pthread_create(&tid[i], NULL, client, NULL);
+
+    if (result) {
+      printf("runway-load: pthread_create failed for client %d: %s\n", i, strerror(result));
+      return 1;
+    }
+  }
+  for (int i = 0; i < clients; i++) {
+    pthread_join(tid[i], NULL);
+  }
+  wall = monotonic_ns() - load.epoch;
+  free(tid);
+  if (quit) {
+    post(ADMISSION_SHUTDOWN, -1, NULL);
+  }
+
+  at_once = malloc(load.count * sizeof(int64_t));
+  queued = malloc(load.count * sizeof(int64_t));
+  late = malloc(load.count * sizeof(int64_t));
+  if (at_once == NULL || queued == NULL || late == NULL) {
+    printf("runway-load: out of memory for the statistics\n");
+    return 1;
+  }
+  for (int i = 0; i < load.count; i++) {
+    const flight *f = &load.flights[i];
+
+    late[i] = f->late_ns;
+    if (f->answer != SLOT_GRANTED) {
+      diverted = diverted + 1;
+    } else if (f->wait_ns == 0) {
+      at_once[n_at_once++] = f->round_trip_ns;
+    } else {
+      queued[n_queued++] = f->wait_ns;
+    }
+  }
+
+  printf("Flew %d aircraft through %s with %d clients in %.1f s: %d granted, %d diverted\n",
+         load.count, name, clients, (double)wall / NSEC_PER_SEC, load.count - diverted, diverted);
+  printf("Admission                 count       p50       p99      p999       max\n");
+  print_times("Round trip (us)", at_once, n_at_once, 1e3);
+  print_times("Queued wait (s)", queued, n_queued, 1e9);
+  print_times("Posted late (ms)", late, load.count, 1e6);
+  printf("Client sleeps on their slot: %llu, server wakeups: %llu\n",
+         (unsigned long long)load.sleeps, (unsigned long long)load.rings);
+
+  free(at_once);
+  free(queued);
+  free(late);
+  free(load.flights);
+  munmap(load.page, sizeof(admission_page));
+  return 0;
+}
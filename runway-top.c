@@ -0,0 +1,169 @@
+/* Live monitor for a running runway simulation.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILTY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/license/>.
+*/
+
+/* Reads the snapshot a simulation started with runway -M NAME publishes and
+ * redraws it every interval: per runway its direction, whether it is open,
+ * the aircraft on it and the queue depths, and over all runways the
+ * throughput, wait percentiles, switches and breaks. It only ever reads the
+ * shared memory, so watching a run does not slow it down. Exits once the
+ * simulation is over.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "metrics.h"
+
+#define NSEC_PER_SEC 1000000000LL
+#define WAIT_TRIES   100         /* Times to look for the object before giving up, 0.1 s apart */
+
+static double seconds(int64_t ns)
+{
+  return (double)ns / NSEC_PER_SEC;
+}
+
+static void sleep_ms(long ms)
+{
+  struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+  nanosleep(&ts, NULL);
+}
+
+/*
+* Function: snapshot
+* Parameters: page - the shared page
+*             copy - where the snapshot goes
+* Returns: void
+* Description: copies the page under its seqlock, retrying while the simulation
+*              is in the middle of writing it.
+ */
+static void snapshot(const metrics_page *page, metrics_page *copy)
+{
+  for (;;) {
+    uint32_t seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+
+    if (seq & 1) {
+      sched_yield();
+      continue;
+    }
+    memcpy(copy, (const void *)page, sizeof(*copy));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) == seq) {
+      return;
+    }
+  }
+}
+
+static void show(const metrics_page *m, const char *name, int clear)
+{
+  static const char *directions[2] = { "NORTH", "SOUTH" };
+
+  if (clear) {
+    printf("\033[H\033[J");
+  }
+  printf("runway pid %d (%s)%s  simulated %.1f s, wall %.1f s\n", m->pid, name,
+         m->done ? "  finished" : "", seconds(m->sim_ns), seconds(m->wall_ns));
+  printf("admitted %llu, %.1f per hour   wait p50 %.1f s  p99 %.1f s  p999 %.1f s  max %.1f s\n",
+         (unsigned long long)m->admitted, m->per_hour, seconds(m->wait_ns[0]),
+         seconds(m->wait_ns[1]), seconds(m->wait_ns[2]), seconds(m->wait_ns[3]));
+  printf("switches %d   breaks %d\n\n", m->switches, m->breaks);
+  printf("runway  direction  state      on runway  com car emg   waiting  com car emg  "
+         "since break  assigned\n");
+  for (int i = 0; i < m->runways && i < METRICS_RUNWAYS; i++) {
+    const metrics_runway *r = &m->runway[i];
+
+    printf("%6d  %-9s  %-9s  %6d/%-2d  %3d %3d %3d   %7d  %3d %3d %3d  %11d  %8d\n", i + 1,
+           directions[r->direction & 1], r->switching ? "switching" : r->on_break ? "break" : "open",
+           r->on_runway[3], m->capacity, r->on_runway[0], r->on_runway[1], r->on_runway[2],
+           r->waiting[0] + r->waiting[1] + r->waiting[2], r->waiting[0], r->waiting[1],
+           r->waiting[2], r->since_break, r->assigned);
+  }
+  fflush(stdout);
+}
+
+static void usage(void)
+{
+  printf("Usage: runway-top [-i interval-ms] [-1] [shared-memory-name]\n"
+         "  Shows the live metrics of a simulation started with runway -M NAME\n"
+         "  (default name /runway). -1 prints a single snapshot and exits.\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *name = "/runway";
+  long interval = 1000;
+  int once = 0;
+  int opt;
+  int fd = -1;
+  metrics_page *page;
+  metrics_page m;
+
+  while ((opt = getopt(argc, argv, "i:1h")) != -1) {
+    if (opt == 'i' && atol(optarg) > 0) {
+      interval = atol(optarg);
+    } else if (opt == '1') {
+      once = 1;
+    } else {
+      usage();
+      return opt == 'h' ? 0 : EINVAL;
+    }
+  }
+  if (optind < argc) {
+    name = argv[optind];
+  }
+
+  // the simulation may not have created the object yet
+  for (int tries = 0; fd < 0 && tries < WAIT_TRIES; tries++) {
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+      sleep_ms(100);
+    }
+  }
+  if (fd < 0) {
+    printf("runway-top: cannot open shared memory %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  page = mmap(NULL, sizeof(*page), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (page == MAP_FAILED) {
+    printf("runway-top: cannot map shared memory %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  while (__atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != METRICS_MAGIC) {
+    sleep_ms(10);
+  }
+
+  do {
+    snapshot(page, &m);
+    show(&m, name, !once && isatty(STDOUT_FILENO));
+    if (!once && !m.done) {
+      sleep_ms(interval);
+    }
+  } while (!once && !m.done);
+
+  munmap(page, sizeof(*page));
+  return 0;
+}
@@ -27,17 +27,33 @@
 #include <errno.h>
 #include <assert.h>
 #include <time.h>
+#include <stdint.h>
+#include <sched.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <linux/futex.h>
+
+#include "metrics.h"
+#include "admission.h"
 
 /*** Constants that define parameters of the simulation ***/
 
 #define MAX_RUNWAY_CAPACITY 2    /* Number of aircraft that can use runway simultaneously */
 #define CONTROLLER_LIMIT 8       /* Number of aircraft the controller can manage before break */
-#define MAX_AIRCRAFT 1000        /* Maximum number of aircraft in the simulation */
 #define FUEL_MIN 20              /* Minimum fuel reserve in seconds */
 #define FUEL_MAX 60              /* Maximum fuel reserve in seconds */
 #define EMERGENCY_TIMEOUT 30     /* Max wait time for emergency aircraft in seconds */
 #define DIRECTION_SWITCH_TIME 5  /* Time required to switch runway direction */
 #define DIRECTION_LIMIT 3        /* Max consecutive aircraft in same direction */
+#define TYPE_LIMIT 4             /* Max consecutive aircraft of the same type */
+#define BREAK_TIME 5             /* Length of a controller break in seconds */
+#define CAPACITY_MAX 8           /* Largest runway capacity -p accepts */
+#define FAIRNESS_BOUND 30        /* Longest a direction keeps the runway while the other waits, -d plan */
 
 #define COMMERCIAL 0
 #define CARGO 1
@@ -48,6 +64,43 @@
 #define EAST  2
 #define WEST  4
 
+#define MODE_THREADS 0           /* One thread per aircraft, real-time sleeps */
+#define MODE_VIRTUAL 1           /* Discrete-event engine on a simulated clock */
+#define MODE_POOL    2           /* Discrete-event engine in real time on a worker pool */
+#define MODE_SERVER  3           /* Discrete-event engine in real time serving clients, -A */
+
+#define WAKE_TARGETED  0         /* Admit waiters on their behalf and signal only them */
+#define WAKE_BROADCAST 1         /* Every change broadcasts cond_check to all waiters */
+
+#define PACK_NONE 0              /* Nobody enters while the runway drains for a switch or break */
+#define PACK_FILL 1              /* Fill free slots of a draining runway with aircraft that fit */
+
+#define PAUSE_SWITCH 0           /* The runway is closed for a direction switch */
+#define PAUSE_BREAK  1           /* ... or a controller break */
+
+#define AC_ARRIVING  0           /* Not yet arrived */
+#define AC_WAITING   1           /* Queued for the runway */
+#define AC_ON_RUNWAY 2           /* Admitted, runway operations in progress */
+#define AC_CLEARED   3           /* Has left the runway */
+#define AC_DIVERTED  4           /* Turned away by the holding stack, -H */
+
+#define HOLD_FULL 0              /* Diverted: the runway's holding stack was full */
+#define HOLD_FUEL 1              /* Diverted: the predicted wait was longer than its fuel */
+
+#define NSEC_PER_SEC 1000000000LL
+#define NSEC_PER_MSEC 1000000LL
+#define MSEC_PER_SEC 1000
+
+#define ARENA_SLAB 256           /* Aircraft records allocated at a time */
+
+#define DEADLINE_SHARE 4         /* A waiting aircraft gets priority in the last 1/N of its window */
+
+#define MAX_RUNWAYS 16           /* Most runways a simulation can have */
+#define ASSIGN_TURN_COST 2       /* Aircraft a wrong-way runway counts as having ahead in line */
+#define METRICS_PERIOD_MS 250    /* Between snapshots published for -M */
+#define PLAN_HORIZON 20          /* Seconds of upcoming trace arrivals the switch planner looks at */
+#define PACK_SCAN 64             /* Wait queue entries looked at for an aircraft that fits, -f fill */
+
 /* TODO */
 /* Add your synchronization variables here */
 
@@ -58,581 +111,5661 @@
  * code that you develop. 
  */
 
-sem_t runway_sem;  // controls how mnay aircrafts can be on runway
-pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; // protects shared variables
-pthread_cond_t cond_check = PTHREAD_COND_INITIALIZER;
-
-static int aircraft_on_runway = 0;       /* Total number of aircraft currently on runway */
-static int commercial_on_runway = 0;     /* Total number of commercial aircraft on runway */
-static int cargo_on_runway = 0;          /* Total number of cargo aircraft on runway */
-static int emergency_on_runway = 0;      /* Total number of emergency aircraft on runway */
-static int aircraft_since_break = 0;     /* Aircraft processed since last controller break */
-static int current_direction = NORTH;    /* Current runway direction (NORTH or SOUTH) */
-static int consecutive_direction = 0;    /* Consecutive aircraft in current direction */
-static int commercial_waiting = 0;
-static int cargo_waiting = 0;
-static int controller_break = 0; 
-static int switching_direction = 0;
-static int last_aircraft_type = -1;
-static int consecutive_type_count = 0;
+pthread_cond_t cond_released = PTHREAD_COND_INITIALIZER;   // the last aircraft record was released
 
+static int simulation_done = 0;          /* All aircraft have cleared, controllers may go home */
+static int num_runways = 1;              /* Runways in use, each with its own controller */
 
-typedef struct 
+/* the rules of the simulation; the defines above are the defaults, -p changes them */
+typedef struct
 {
-  int arrival_time;         // time between the arrival of this aircraft and the previous aircraft
-  int runway_time;          // time the aircraft needs to spend on the runway
-  int aircraft_id;
-  int aircraft_type;        // COMMERCIAL, CARGO, or EMERGENCY
-  int fuel_reserve;         // Randomly assigned fuel reserve (FUEL_MIN to FUEL_MAX seconds)
-  time_t arrival_timestamp; // timestamp when aircraft thread was created
-} aircraft_info;
+  int capacity;            // aircraft that can use a runway simultaneously
+  int controller_limit;    // aircraft a controller handles before a break
+  int direction_limit;     // consecutive aircraft in one direction before a switch
+  int type_limit;          // consecutive aircraft of one type before a switch
+  int switch_time;         // milliseconds a direction switch takes
+  int break_time;          // milliseconds a controller break takes
+  int fairness;            // milliseconds a direction may keep the runway while the other waits
+} sim_params;
 
-/* 
-* Function:   initialize
-* Parameters: ai - pointer to aircraft_info array to populate 
-*             filename - string containing input file path
-* Returns: int - number of aircraft successfully loaded from file
-* Description: initializes all simulation variables and synchroniztion primitives.
-*             Reads aircraft data from input file and assigns random fuel reserves
-*             to each aircraft.
- */
-static int initialize(aircraft_info *ai, char *filename) 
-{
-  aircraft_on_runway    = 0;
-  commercial_on_runway  = 0;
-  cargo_on_runway       = 0;
-  emergency_on_runway   = 0;
-  aircraft_since_break  = 0;
-  current_direction     = NORTH;
-  consecutive_direction = 0;
-  commercial_waiting = 0;
-  cargo_waiting = 0;
-  controller_break = 0;
-
-  /* Initialize your synchronization variables (and 
-   * other variables you might use) here
-   */
-  sem_init(&runway_sem, 0, MAX_RUNWAY_CAPACITY);
+static sim_params params = { MAX_RUNWAY_CAPACITY, CONTROLLER_LIMIT, DIRECTION_LIMIT, TYPE_LIMIT,
+                             DIRECTION_SWITCH_TIME * MSEC_PER_SEC, BREAK_TIME * MSEC_PER_SEC,
+                             FAIRNESS_BOUND * MSEC_PER_SEC };
 
-  /* seed random number generator for fuel reserves */
-  srand(time(NULL));
+static int sim_mode = MODE_THREADS;      /* MODE_* this run uses */
+static int64_t sim_epoch = 0;            /* Monotonic time at which the run started */
+static int wakeup_mode = WAKE_TARGETED;
+static int pack_mode = PACK_NONE;
+static int holding_depth = -1;           /* -H: aircraft a holding stack takes, 0 for no limit, -1 if off */
+static unsigned sim_seed;                /* Seeds the fuel reserves; -S, or the time of day */
 
-  /* Read in the data file and initialize the aircraft array */
-  FILE *fp;
+/* reads the monotonic clock in nanoseconds */
+static int64_t monotonic_ns(void)
+{
+  struct timespec ts;
 
-  if((fp=fopen(filename, "r")) == NULL) 
-  {
-    printf("Cannot open input file %s for reading.\n", filename);
-    exit(1);
-  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
 
-  int i = 0;
-  char line[256];
-  while (fgets(line, sizeof(line), fp) && i < MAX_AIRCRAFT) 
-  {
-    /* Skip comment lines and empty lines */
-    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
-      continue;
-    }
-    
-    /* Parse the line */
-    if (sscanf(line, "%d%d%d", &(ai[i].aircraft_type), &(ai[i].arrival_time), 
-               &(ai[i].runway_time)) == 3) {
-      /* Assign random fuel reserve between FUEL_MIN and FUEL_MAX */
-      ai[i].fuel_reserve = FUEL_MIN + (rand() % (FUEL_MAX - FUEL_MIN + 1));
-      i = i + 1;
-    }
+/* sleeps until the monotonic clock reads t nanoseconds, however often a signal interrupts */
+static void sleep_until(int64_t t)
+{
+  struct timespec ts = { (time_t)(t / NSEC_PER_SEC), (long)(t % NSEC_PER_SEC) };
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
   }
+}
 
-  fclose(fp);
-  return i;
+/* sleeps for the given number of milliseconds on the monotonic clock */
+static void sleep_ms(int ms)
+{
+  sleep_until(monotonic_ns() + (int64_t)ms * NSEC_PER_MSEC);
 }
 
-/* Code executed by controller to simulate taking a break 
- * You do not need to add anything here.  
- */
-__attribute__((unused)) static void take_break() 
+/* writes milliseconds as seconds with only the decimals needed, "5" or "2.25" */
+static const char *ms_string(char *buf, size_t size, int64_t ms)
 {
-  printf("The air traffic controller is taking a break now.\n");
-  sleep(5);
-  assert( aircraft_on_runway == 0 );
-  aircraft_since_break = 0;
+  int frac = (int)(ms % MSEC_PER_SEC);
+  int digits = 3;
+
+  if (frac == 0) {
+    snprintf(buf, size, "%lld", (long long)(ms / MSEC_PER_SEC));
+    return buf;
+  }
+  for (; frac % 10 == 0; frac = frac / 10) {
+    digits = digits - 1;
+  }
+  snprintf(buf, size, "%lld.%0*d", (long long)(ms / MSEC_PER_SEC), digits, frac);
+  return buf;
 }
 
-/* Code executed to switch runway direction
- * You do not need to add anything here.
- */
-__attribute__((unused)) static void switch_direction()
+static const char *direction_name(int direction)
 {
-  printf("Switching runway direction from %s to %s\n",
-         current_direction == NORTH ? "NORTH" : "SOUTH",
-         current_direction == NORTH ? "SOUTH" : "NORTH");
-  
-  assert( aircraft_on_runway == 0 );  // Runway must be empty to switch
-  
-  sleep(DIRECTION_SWITCH_TIME);
-  
-  current_direction = (current_direction == NORTH) ? SOUTH : NORTH;
-  consecutive_direction = 0;
-  
-  printf("Runway direction switched to %s\n",
-         current_direction == NORTH ? "NORTH" : "SOUTH");
+  return direction == NORTH ? "NORTH" : "SOUTH";
 }
 
-/* 
-* Function: controller_thread
-* Parameters: arg - void pointer for pthread compatability
-* Returns: void* - NULL on exit
-* Description - main thread function for the air traffic controller. The function 
-*               monitors runway state, handles direction switches when consecutive limit 
-*               is reached, or opposite trafic is waiting, manages controller breaks as well
+static const char *aircraft_label(int type)
+{
+  if (type == COMMERCIAL) {
+    return "Commercial";
+  }
+  return type == CARGO ? "Cargo" : "EMERGENCY";
+}
+
+/*** Event log ***/
+
+/* Simulation progress is logged as fixed-size binary events instead of being
+ * printed where it happens. Every thread appends to its own single-producer
+ * ring buffer, so logging takes no lock: one atomic increment fixes the event's
+ * place in the global order and one release store publishes it. A drainer
+ * thread merges the rings back into that order and either renders the events
+ * as the usual text on stdout or, with -l, writes them unchanged to a file that
+ * `runway -r` renders later. With -T it also renders them as a timeline, see
+ * timeline_render().
  */
-void *controller_thread(void *arg) 
+
+#define LOG_RING_SIZE   1024      /* Events per thread ring, a power of two */
+#define LOG_MAGIC       "RWYL"
+#define LOG_VERSION     5
+#define LOG_HEADER_SIZE 16
+#define LOG_IDLE_NS     200000    /* Drainer sleep while the rings are empty */
+
+#define LOG_CONTROLLER_START 0    /* the controller has arrived */
+#define LOG_ON_RUNWAY        1    /* arg: fuel reserve, arg2: direction */
+#define LOG_RUNWAY_BEGIN     2    /* arg: runway time in milliseconds */
+#define LOG_RUNWAY_END       3    /* runway operations complete */
+#define LOG_CLEARED          4    /* the aircraft has cleared the runway */
+#define LOG_SWITCHING        5    /* arg: old direction, arg2: new direction */
+#define LOG_SWITCHED         6    /* arg: new direction */
+#define LOG_BREAK            7    /* arg: 1 if the break is taken early */
+#define LOG_PRIORITY         8    /* arg: 1 if the emergency window, not fuel, runs out */
+#define LOG_DIVERTED         9    /* arg: fuel reserve, arg2: predicted wait in ms, -1 if the stack was full */
+/* not printed, only the timeline shows them */
+#define LOG_ARRIVED          10   /* the aircraft starts waiting, arg: fuel reserve */
+#define LOG_CLOSED           11   /* the runway drains for arg: PAUSE_SWITCH or PAUSE_BREAK */
+#define LOG_BREAK_OVER       12   /* the controller is back and the runway open */
+
+typedef struct
 {
-  // Suppress the warning for now
- (void)arg;
+  int64_t time;      // simulation time in nanoseconds
+  uint64_t seq;      // position in the global order
+  int8_t kind;       // LOG_*
+  int8_t runway;     // index of the runway it happened on
+  int16_t type;      // aircraft type, -1 for controller events
+  int32_t id;        // aircraft id, -1 for controller events
+  int32_t arg;       // kind specific, see LOG_*
+  int32_t arg2;
+} log_event;
 
-  printf("The air traffic controller arrived and is beginning operations\n");
+typedef struct log_ring
+{
+  log_event ev[LOG_RING_SIZE];
+  uint64_t head __attribute__((aligned(64)));  // next slot the owner writes
+  uint64_t tail_seen;                          // owner's last look at tail
+  uint64_t tail __attribute__((aligned(64)));  // next slot the drainer reads
+  uint64_t head_seen;                          // drainer's last look at head
+  struct log_ring *next;                       // every ring, newest first
+  struct log_ring *next_free;                  // rings no thread owns at the moment
+} log_ring;
 
-  /* Loop while waiting for aircraft to arrive. */
-  while (1) 
-  {
-    /* TODO */
-    /* Add code here to handle aircraft requests, controller breaks,      */
-    /* and runway direction switches.                                     */
-    /* Currently the body of the loop is empty.  There's no communication */
-    /* between controller and aircraft, i.e. all aircraft are admitted    */
-    /* without regard for runway capacity, aircraft type, direction,      */
-    /* priorities, and whether the controller needs a break.              */
-    /* You need to add all of this.                                       */
-    pthread_mutex_lock(&lock);
+static struct
+{
+  log_ring *rings;          // read by the drainer without locks, rings are never freed
+  log_ring *free_rings;     // protected by registry
+  pthread_mutex_t registry; // only taken when a thread gets or gives back a ring
+  uint64_t seq;             // next sequence number, taken with an atomic increment
+  uint64_t next_seq;        // drainer: next sequence number to emit
+  FILE *binary;             // drainer writes raw events here, NULL for text
+  FILE *timeline;           // -T: drainer also writes trace events here
+  int stop;                 // the drainer empties the rings and exits
+  sem_t doorbell;           // posted by a producer that found its ring full
+  pthread_t drainer;
+  int runways;              // number of runways, their lines are tagged if more than one
+  int capacity;             // slots per runway on the timeline
+} event_log = { .registry = PTHREAD_MUTEX_INITIALIZER };
 
-    /*
-    * the controller will check whether too many aircrafts have used the runway in
-    * the same direction or of the same type consecutively. This is to prevent the runway 
-    * going in one direction or aircraft type, maintaing fairness.
-    */
-    if (consecutive_direction >= DIRECTION_LIMIT || consecutive_type_count >= 4) {
-      int should_switch = 0;
-      // determine if switch is justified: satisfies 2 arguments
-      if (current_direction == NORTH && cargo_waiting > 0) {
-        should_switch = 1;
-      } else if (current_direction == SOUTH && commercial_waiting > 0) {
-        should_switch = 1;
-      }
+static __thread log_ring *log_own_ring;
 
-        if (should_switch) {
-          switching_direction = 1; // indicate runway direction switch
-          while (aircraft_on_runway > 0) {
-          pthread_cond_wait(&cond_check, &lock); // wait till all aircrafts currently on are done
-        }
-        sem_wait(&runway_sem);
-        sem_wait(&runway_sem);
-        switch_direction();
-        consecutive_direction = 0; // reset counters for tracking
-        switching_direction = 0;
-        sem_post(&runway_sem);
-        sem_post(&runway_sem);
-      }
-    }
-    
-    /*
-    * the controller must take a break to simulate fatigue. During this, no new 
-    * aircrafts can use the runway until the controller returns.
-    */
-    if (aircraft_since_break >= CONTROLLER_LIMIT) {
-      controller_break = 1;
-      // ensure all operations finish before controller takes a break
-      while (aircraft_on_runway > 0) {
-        pthread_cond_wait(&cond_check, &lock);
-      }
+static int64_t sim_now(void);
 
-      pthread_mutex_unlock(&lock); // allow other mutex threads to proceed while on break
-      take_break(); // rest break
-      pthread_mutex_lock(&lock); // resume control after break
-      controller_break = 0; 
-      aircraft_since_break = 0;
-    }
+/* gives the calling thread a ring of its own, reusing one if another thread is done with it */
+static log_ring *log_attach(void)
+{
+  log_ring *ring;
 
-    // wake up waiting threads so they can check if conditions have changed
-    pthread_cond_broadcast(&cond_check);
-    pthread_mutex_unlock(&lock);
-    /* Allow thread to be
-     cancelled */
-    pthread_testcancel();
-    usleep(100000); // 100ms sleep to prevent busy waiting
+  pthread_mutex_lock(&event_log.registry);
+  ring = event_log.free_rings;
+  if (ring != NULL) {
+    event_log.free_rings = ring->next_free;
+  } else {
+    ring = calloc(1, sizeof(log_ring));
+    if (ring == NULL) {
+      printf("runway: out of memory for the event log\n");
+      exit(1);
+    }
+    ring->next = event_log.rings;
+    __atomic_store_n(&event_log.rings, ring, __ATOMIC_RELEASE);
   }
-  pthread_exit(NULL);
+  pthread_mutex_unlock(&event_log.registry);
+
+  log_own_ring = ring;
+  return ring;
 }
 
+/* hands the calling thread's ring to the next thread; events still queued in it stay in order */
+static void log_detach(void)
+{
+  if (log_own_ring == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&event_log.registry);
+  log_own_ring->next_free = event_log.free_rings;
+  event_log.free_rings = log_own_ring;
+  pthread_mutex_unlock(&event_log.registry);
+  log_own_ring = NULL;
+}
 
 /* 
-* Function: commercial_enter
-* Parameters: aircraft_info - pointer to aircraft structure
+* Function: log_emit
+* Parameters: kind - LOG_*
+*             runway - index of the runway it happens on
+*             type, id - the aircraft, -1 for controller events
+*             arg, arg2 - see LOG_*
 * Returns: void
-* Description: handles the sync for a commercial airplane requesting runway access. Blocks until
-*              the aircraft can safetly use the runway according to all constraints
+* Description: appends an event to the calling thread's ring. Waits for the
+*              drainer only if the ring is full, and does so before taking a
+*              sequence number so the drainer never waits on a blocked thread.
  */
-void commercial_enter(aircraft_info *arg) 
+static void log_emit(int kind, int runway, int type, int id, int arg, int arg2)
 {
-  // Suppress the compiler warning
-  (void)arg;
-
-  /* TODO */
-  /* Request permission to use the runway. You might also want to add      */
-  /* synchronization for the simulation variables below.                   */
-  /* Consider: runway capacity, direction (commercial prefer NORTH),       */
-  /* controller breaks, fuel levels, emergency priorities, and fairness.   */
-  /*  YOUR CODE HERE.                                                      */ 
-  pthread_mutex_lock(&lock);
+  log_ring *ring = log_own_ring != NULL ? log_own_ring : log_attach();
+  uint64_t head = ring->head;
+  log_event *ev;
 
-  /*
-  * a commercial aircraft must wait if runway is at max capacity, current direction is south,
-  * runway direction is being switched, and if the controller is on break
-  */
-  while (aircraft_on_runway >= MAX_RUNWAY_CAPACITY || current_direction == SOUTH  
-  || switching_direction || controller_break) {
-    commercial_waiting = commercial_waiting + 1; // add count to waiting 
-    pthread_cond_wait(&cond_check, &lock);  // resume when conditions change
-    commercial_waiting = commercial_waiting - 1;
+  // only look at the drainer's cache line when the ring seems full
+  if (head - ring->tail_seen >= LOG_RING_SIZE) {
+    ring->tail_seen = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head - ring->tail_seen >= LOG_RING_SIZE) {
+      sem_post(&event_log.doorbell);  // don't leave it to the drainer's next poll
+      do {
+        sched_yield();
+        ring->tail_seen = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+      } while (head - ring->tail_seen >= LOG_RING_SIZE);
+    }
   }
 
-  aircraft_on_runway    = aircraft_on_runway + 1;
-  aircraft_since_break  = aircraft_since_break + 1;
-  commercial_on_runway  = commercial_on_runway + 1;
-  consecutive_direction = consecutive_direction + 1;
+  ev = &ring->ev[head & (LOG_RING_SIZE - 1)];
+  ev->time = sim_now();
+  ev->seq = __atomic_fetch_add(&event_log.seq, 1, __ATOMIC_RELAXED);
+  ev->kind = (int8_t)kind;
+  ev->runway = (int8_t)runway;
+  ev->type = (int16_t)type;
+  ev->id = id;
+  ev->arg = arg;
+  ev->arg2 = arg2;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
 
-// tracking consecutive aircraft types
-if (arg->aircraft_type == last_aircraft_type) {
-  consecutive_type_count = consecutive_type_count + 1;
- } else {
-    last_aircraft_type = arg->aircraft_type;
-    consecutive_type_count = 1;
-  }
+/* text renderer: the lines the simulation has always printed */
+static void log_render(const log_event *ev, FILE *out)
+{
+  const char *label = aircraft_label(ev->type);
+  char time_s[24];
 
-  pthread_cond_broadcast(&cond_check);
-  pthread_mutex_unlock(&lock);
+  if (ev->kind >= LOG_ARRIVED) {
+    return;
+  }
+  if (event_log.runways > 1) {
+    fprintf(out, "Runway %d: ", ev->runway + 1);
+  }
+  switch (ev->kind) {
+  case LOG_CONTROLLER_START:
+    fprintf(out, "The air traffic controller arrived and is beginning operations\n");
+    break;
+  case LOG_ON_RUNWAY:
+    fprintf(out, "%s aircraft %d (fuel: %ds) is now on the runway (direction: %s)\n",
+            label, ev->id, ev->arg, direction_name(ev->arg2));
+    break;
+  case LOG_RUNWAY_BEGIN:
+    fprintf(out, "%s aircraft %d begins runway operations for %s seconds\n",
+            label, ev->id, ms_string(time_s, sizeof(time_s), ev->arg));
+    break;
+  case LOG_RUNWAY_END:
+    fprintf(out, "%s aircraft %d completes runway operations and prepares to depart\n",
+            label, ev->id);
+    break;
+  case LOG_CLEARED:
+    fprintf(out, "%s aircraft %d has cleared the runway\n", label, ev->id);
+    break;
+  case LOG_SWITCHING:
+    fprintf(out, "Switching runway direction from %s to %s\n",
+            direction_name(ev->arg), direction_name(ev->arg2));
+    break;
+  case LOG_SWITCHED:
+    fprintf(out, "Runway direction switched to %s\n", direction_name(ev->arg));
+    break;
+  case LOG_BREAK:
+    fprintf(out, "The air traffic controller is taking a break now%s.\n",
+            ev->arg ? ", ahead of time" : "");
+    break;
+  case LOG_PRIORITY:
+    if (ev->arg) {
+      fprintf(out, "EMERGENCY aircraft %d is close to its admission limit and gets priority\n",
+              ev->id);
+    } else {
+      fprintf(out, "%s aircraft %d is low on fuel and gets priority\n", label, ev->id);
+    }
+    break;
+  case LOG_DIVERTED:
+    if (ev->arg2 < 0) {
+      fprintf(out, "%s aircraft %d (fuel: %ds) is diverted, the holding stack is full\n",
+              label, ev->id, ev->arg);
+    } else {
+      fprintf(out, "%s aircraft %d (fuel: %ds) is diverted, it would wait about %s seconds\n",
+              label, ev->id, ev->arg, ms_string(time_s, sizeof(time_s), ev->arg2));
+    }
+    break;
+  }
 }
 
-/* 
-* Function: cargo_enter
-* Parameters: aircraft_info - pointer to aircraft structure
-* Returns: void
-* Description: handles the sync for a cargo airplane requesting runway access. Blocks until
-*              the aircraft can safetly use the runway according to all constraints
+/* Timeline renderer: the events as Chrome trace-event JSON, which
+ * chrome://tracing and ui.perfetto.dev open. Every runway is a process with a
+ * track for its direction switches, one for controller breaks (each preceded
+ * by the time the runway drained for it) and one per slot, showing which
+ * aircraft held it; aircraft are tracks of their own in one more process,
+ * waiting and then on the runway. Begin and end events are written as they
+ * happen, so only the slots need remembering.
  */
-void cargo_enter(aircraft_info *ai) 
-{
-  (void)ai;
 
-  /* TODO */
-  /* Request permission to use the runway. You might also want to add      */
-  /* synchronization for the simulation variables below.                   */
-  /* Consider: runway capacity, direction (cargo prefer SOUTH),            */
-  /* controller breaks, fuel levels, emergency priorities, and fairness.   */
-  /*  YOUR CODE HERE.                                                      */ 
+#define TIMELINE_SWITCHES 1       /* Track ids within a runway's process */
+#define TIMELINE_BREAKS   2
+#define TIMELINE_SLOT     3       /* ... first of the slot tracks */
 
-  pthread_mutex_lock(&lock);
+static struct
+{
+  int events;                             // written so far, for the separating commas
+  int slot[MAX_RUNWAYS][CAPACITY_MAX];    // aircraft id holding each slot, -1 if free
+  int draining[MAX_RUNWAYS][2];           // a drain for PAUSE_SWITCH or PAUSE_BREAK is open
+} timeline;
 
-  // same thing as commercial_enter(), but for cargo aircrafts
-   while (aircraft_on_runway >= MAX_RUNWAY_CAPACITY || current_direction == NORTH
-  || switching_direction || controller_break) {
-    cargo_waiting = cargo_waiting + 1;
-    pthread_cond_wait(&cond_check, &lock);
-    cargo_waiting = cargo_waiting - 1;
+/* writes one trace event; name == NULL for an end event */
+static void timeline_event(FILE *out, char phase, int64_t time, int pid, int tid, const char *name)
+{
+  fprintf(out, "%s\n{\"ph\":\"%c\",\"ts\":%lld.%03d,\"pid\":%d,\"tid\":%d", timeline.events ? "," : "",
+          phase, (long long)(time / 1000), (int)(time % 1000), pid, tid);
+  if (name != NULL) {
+    fprintf(out, ",\"name\":\"%s\"", name);
   }
-
-  aircraft_on_runway    = aircraft_on_runway + 1;
-  aircraft_since_break  = aircraft_since_break + 1;
-  cargo_on_runway       = cargo_on_runway + 1;
-  consecutive_direction = consecutive_direction + 1;\
-
-if (ai->aircraft_type == last_aircraft_type) {
-  consecutive_type_count = consecutive_type_count + 1;
- } else {
-    last_aircraft_type = ai->aircraft_type;
-    consecutive_type_count = 1;
+  if (phase == 'i') {
+    fprintf(out, ",\"s\":\"t\"");
   }
+  fprintf(out, "}");
+  timeline.events = timeline.events + 1;
+}
 
-
-  pthread_cond_broadcast(&cond_check);
-  pthread_mutex_unlock(&lock);
+/* names a process (tid < 0) or a track */
+static void timeline_name(FILE *out, int pid, int tid, const char *name)
+{
+  fprintf(out, "%s\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"args\":{\"name\":\"%s\"}}",
+          timeline.events ? "," : "", pid, tid < 0 ? 0 : tid, tid < 0 ? "process_name" : "thread_name",
+          name);
+  timeline.events = timeline.events + 1;
 }
 
 /* 
-* Function: emergency_enter
-* Parameters: aircraft_info - pointer to aircraft structure
-* Returns: void
-* Description: handles the sync for a emergency airplane requesting runway access. Blocks until
-*              the aircraft can safetly use the runway according to all constraints
+* Function: timeline_begin
+* Parameters: filename - JSON file to write
+*             runways, capacity - of the run
+* Returns: int - 0 on success, 1 if the file cannot be written
+* Description: starts the trace and names the tracks of every runway.
  */
-void emergency_enter(aircraft_info *ai) 
+static int timeline_begin(const char *filename, int runways, int capacity)
 {
-  (void)ai;
+  char name[32];
 
-  /* TODO */
-  /* Request permission to use the runway. You might also want to add      */
-  /* synchronization for the simulation variables below.                   */
-  /* Emergency aircraft have priority and must be admitted within 30s,     */
-  /* but still respect runway capacity and controller breaks.              */
-  /* Emergency aircraft can use either direction.                          */
-  /*  YOUR CODE HERE.                                                      */ 
+  if ((event_log.timeline = fopen(filename, "w")) == NULL) {
+    printf("Cannot open timeline %s for writing.\n", filename);
+    return 1;
+  }
+  memset(&timeline, 0, sizeof(timeline));
+  memset(timeline.slot, -1, sizeof(timeline.slot));
+  fprintf(event_log.timeline, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  for (int r = 0; r < runways; r++) {
+    snprintf(name, sizeof(name), "Runway %d", r + 1);
+    timeline_name(event_log.timeline, r + 1, -1, name);
+    timeline_name(event_log.timeline, r + 1, TIMELINE_SWITCHES, "Direction switches");
+    timeline_name(event_log.timeline, r + 1, TIMELINE_BREAKS, "Controller breaks");
+    for (int k = 0; k < capacity && k < CAPACITY_MAX; k++) {
+      snprintf(name, sizeof(name), "Slot %d", k + 1);
+      timeline_name(event_log.timeline, r + 1, TIMELINE_SLOT + k, name);
+    }
+  }
+  timeline_name(event_log.timeline, runways + 1, -1, "Aircraft");
+  return 0;
+}
 
+/* finishes the trace once the last event is written */
+static void timeline_end(void)
+{
+  if (event_log.timeline != NULL) {
+    fprintf(event_log.timeline, "\n]}\n");
+    fclose(event_log.timeline);
+    event_log.timeline = NULL;
+  }
+}
 
-  pthread_mutex_lock(&lock);
-  while(aircraft_on_runway >= MAX_RUNWAY_CAPACITY || controller_break == 1 
-  || switching_direction == 1) {
-    pthread_cond_wait(&cond_check, &lock);
+/* ends the drain on a switch or break track when the switch or break starts */
+static void timeline_drained(FILE *out, const log_event *ev, int kind)
+{
+  if (timeline.draining[ev->runway][kind]) {
+    timeline_event(out, 'E', ev->time, ev->runway + 1, TIMELINE_SWITCHES + kind, NULL);
+    timeline.draining[ev->runway][kind] = 0;
   }
+}
 
-  aircraft_on_runway = aircraft_on_runway + 1;
-  aircraft_since_break = aircraft_since_break + 1;
-  emergency_on_runway = emergency_on_runway + 1;
-  consecutive_direction = consecutive_direction + 1;
+/* timeline renderer: the trace events of one log event */
+static void timeline_render(const log_event *ev, FILE *out)
+{
+  int pid = ev->runway + 1;
+  int aircraft = event_log.runways + 1;  // process of the aircraft tracks
+  int *slot = timeline.slot[ev->runway];
+  char name[48];
+  int k;
 
-  pthread_cond_broadcast(&cond_check);
-  pthread_mutex_unlock(&lock);
+  switch (ev->kind) {
+  case LOG_ARRIVED:
+    snprintf(name, sizeof(name), "%s %d", aircraft_label(ev->type), ev->id);
+    timeline_name(out, aircraft, ev->id + 1, name);
+    snprintf(name, sizeof(name), "waiting for runway %d", ev->runway + 1);
+    timeline_event(out, 'B', ev->time, aircraft, ev->id + 1, name);
+    break;
+  case LOG_ON_RUNWAY:
+    for (k = 0; k < CAPACITY_MAX - 1 && slot[k] >= 0; k++) {
+    }
+    slot[k] = ev->id;
+    snprintf(name, sizeof(name), "%s %d", aircraft_label(ev->type), ev->id);
+    timeline_event(out, 'B', ev->time, pid, TIMELINE_SLOT + k, name);
+    timeline_event(out, 'E', ev->time, aircraft, ev->id + 1, NULL);
+    snprintf(name, sizeof(name), "on runway %d, %s", ev->runway + 1, direction_name(ev->arg2));
+    timeline_event(out, 'B', ev->time, aircraft, ev->id + 1, name);
+    break;
+  case LOG_CLEARED:
+    for (k = 0; k < CAPACITY_MAX; k++) {
+      if (slot[k] == ev->id) {
+        slot[k] = -1;
+        timeline_event(out, 'E', ev->time, pid, TIMELINE_SLOT + k, NULL);
+        break;
+      }
+    }
+    timeline_event(out, 'E', ev->time, aircraft, ev->id + 1, NULL);
+    break;
+  case LOG_PRIORITY:
+    timeline_event(out, 'i', ev->time, aircraft, ev->id + 1, "gets priority");
+    break;
+  case LOG_DIVERTED:
+    snprintf(name, sizeof(name), "%s %d", aircraft_label(ev->type), ev->id);
+    timeline_name(out, aircraft, ev->id + 1, name);
+    timeline_event(out, 'i', ev->time, aircraft, ev->id + 1, "diverted");
+    break;
+  case LOG_CLOSED:
+    timeline_event(out, 'B', ev->time, pid, TIMELINE_SWITCHES + ev->arg, "runway draining");
+    timeline.draining[ev->runway][ev->arg] = 1;
+    break;
+  case LOG_SWITCHING:
+    timeline_drained(out, ev, PAUSE_SWITCH);
+    snprintf(name, sizeof(name), "switch to %s", direction_name(ev->arg2));
+    timeline_event(out, 'B', ev->time, pid, TIMELINE_SWITCHES, name);
+    break;
+  case LOG_SWITCHED:
+    timeline_event(out, 'E', ev->time, pid, TIMELINE_SWITCHES, NULL);
+    break;
+  case LOG_BREAK:
+    timeline_drained(out, ev, PAUSE_BREAK);
+    timeline_event(out, 'B', ev->time, pid, TIMELINE_BREAKS, ev->arg ? "early break" : "break");
+    break;
+  case LOG_BREAK_OVER:
+    timeline_event(out, 'E', ev->time, pid, TIMELINE_BREAKS, NULL);
+    break;
+  }
 }
 
-/* Code executed by an aircraft to simulate the time spent on the runway
- * You do not need to add anything here.  
- */
-static void use_runway(int t) 
+/* passes one event to the configured outputs */
+static void log_output(const log_event *ev)
 {
-  sleep(t);
+  if (event_log.timeline != NULL) {
+    timeline_render(ev, event_log.timeline);
+  }
+  if (event_log.binary != NULL) {
+    fwrite(ev, sizeof(*ev), 1, event_log.binary);
+  } else {
+    log_render(ev, stdout);
+  }
 }
 
+/* drainer: the event in slot tail of a ring, NULL if it has not been published */
+static log_event *log_peek(log_ring *ring, uint64_t tail)
+{
+  if (tail == ring->head_seen) {
+    ring->head_seen = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (tail == ring->head_seen) {
+      return NULL;
+    }
+  }
+  return &ring->ev[tail & (LOG_RING_SIZE - 1)];
+}
 
 /* 
-* Function: commercial_leave
+* Function: log_drain
 * Parameters: None
-* Returns: void
-* Description: handles synchronization when a commercial aircraft departs the runway. will
-*              decrement aircraft counter and signals waiting threads that runway space may
-*              be available.
+* Returns: int - number of events written
+* Description: writes out events in sequence order for as long as the next
+*              one has been published. Each round picks the ring whose oldest
+*              event is next and keeps taking from it while its events follow
+*              on, handing the slots back to the owner once per round.
  */
-static void commercial_leave() 
+static int log_drain(void)
 {
-  /* 
-   *  TODO
-   *  YOUR CODE HERE.
-   */
-  pthread_mutex_lock(&lock); // ensure no race conditions occur
+  int written = 0;
 
-  aircraft_on_runway = aircraft_on_runway - 1;
-  commercial_on_runway = commercial_on_runway - 1;
+  for (;;) {
+    log_ring *ring;
+    log_ring *best = NULL;
+    log_event *ev;
+    uint64_t tail;
 
-  pthread_cond_broadcast(&cond_check); // signal all threads to recheck entry conditions
-  pthread_mutex_unlock(&lock); // unlock to allow other threads
+    for (ring = __atomic_load_n(&event_log.rings, __ATOMIC_ACQUIRE); ring != NULL; ring = ring->next) {
+      ev = log_peek(ring, ring->tail);
+      if (ev != NULL && ev->seq == event_log.next_seq) {
+        best = ring;
+        break;
+      }
+    }
+    if (best == NULL) {
+      return written;  // next event not published yet, or nothing left
+    }
+
+    tail = best->tail;
+    while ((ev = log_peek(best, tail)) != NULL && ev->seq == event_log.next_seq) {
+      log_output(ev);
+      event_log.next_seq = event_log.next_seq + 1;
+      tail = tail + 1;
+      written = written + 1;
+    }
+    __atomic_store_n(&best->tail, tail, __ATOMIC_RELEASE);
+  }
 }
 
-/* 
-* Function: cargo_leave
-* Parameters: None
-* Returns: void
-* Description: handles synchronization when a cargo aircraft departs the runway. will
-*              decrement aircraft counter and signals waiting threads that runway space may
-*              be available.
- */
-static void cargo_leave() 
+static void *log_drainer(void *arg)
 {
-  /* 
-   * TODO
-   * YOUR CODE HERE. 
-   */
-  pthread_mutex_lock(&lock); // prevent race conditions
+  (void)arg;
+  for (;;) {
+    int stopping = __atomic_load_n(&event_log.stop, __ATOMIC_ACQUIRE);
 
-  aircraft_on_runway = aircraft_on_runway - 1;
-  cargo_on_runway = cargo_on_runway - 1;
+    if (log_drain() == 0) {
+      struct timespec ts;
+      int64_t until = monotonic_ns() + LOG_IDLE_NS;
 
-  pthread_cond_broadcast(&cond_check); // signal all threads recheck
-  pthread_mutex_unlock(&lock); // unlock for other threads
+      if (stopping) {
+        break;  // every producer was done before stop was set
+      }
+      ts.tv_sec  = until / NSEC_PER_SEC;
+      ts.tv_nsec = until % NSEC_PER_SEC;
+      sem_clockwait(&event_log.doorbell, CLOCK_MONOTONIC, &ts);
+    }
+  }
+  return NULL;
 }
 
 /* 
-* Function: emergency_leave
-* Parameters: None
+* Function: log_start
+* Parameters: filename - file for the raw binary events, NULL to print text
+*             timeline_to - file for the -T timeline, NULL for none
 * Returns: void
-* Description: handles synchronization when a emergency aircraft departs the runway. will
-*              decrement aircraft counter and signals waiting threads that runway space may
-*              be available.
+* Description: starts the drainer. Events may be logged from any thread after this.
  */
-static void emergency_leave() 
+static void log_start(const char *filename, const char *timeline_to)
 {
-  /* 
-   * TODO
-   * YOUR CODE HERE. 
-   */
-  pthread_mutex_lock(&lock); // prevent race conditions
+  int result;
 
-  aircraft_on_runway = aircraft_on_runway - 1;
-  emergency_on_runway = emergency_on_runway - 1;
+  if (filename != NULL) {
+    unsigned char header[LOG_HEADER_SIZE] = { 0 };
 
-  pthread_cond_broadcast(&cond_check); // signal for all threads to recheck conditions
-  pthread_mutex_unlock(&lock); // unlock for threads
+    if ((event_log.binary = fopen(filename, "wb")) == NULL) {
+      printf("Cannot open event log %s for writing.\n", filename);
+      exit(1);
+    }
+    memcpy(header, LOG_MAGIC, 4);
+    header[4] = LOG_VERSION;
+    header[8] = (unsigned char)sizeof(log_event);
+    header[9] = (unsigned char)num_runways;
+    header[10] = (unsigned char)params.capacity;
+    fwrite(header, 1, LOG_HEADER_SIZE, event_log.binary);
+  }
+
+  if (timeline_to != NULL && timeline_begin(timeline_to, num_runways, params.capacity) != 0) {
+    exit(1);
+  }
+  event_log.runways = num_runways;
+  sem_init(&event_log.doorbell, 0, 0);
+  result = pthread_create(&event_log.drainer, NULL, log_drainer, NULL);
+  if (result) {
+    printf("runway: pthread_create failed for the log drainer: %s\n", strerror(result));
+    exit(1);
+  }
 }
 
-/* Main code for commercial aircraft threads.  
- * You do not need to change anything here, but you can add
- * debug statements to help you during development/debugging.
+/* writes out everything logged so far and stops the drainer; call once all producers are done */
+static void log_stop(void)
+{
+  __atomic_store_n(&event_log.stop, 1, __ATOMIC_RELEASE);
+  pthread_join(event_log.drainer, NULL);
+  sem_destroy(&event_log.doorbell);
+  if (event_log.binary != NULL) {
+    fclose(event_log.binary);
+    event_log.binary = NULL;
+  }
+  timeline_end();
+  log_detach();
+}
+
+/* 
+* Function: log_replay
+* Parameters: filename - binary event log written with -l
+*             timeline_to - write the -T timeline here instead, NULL to print
+* Returns: int - 0 on success, 1 if the file is not an event log
+* Description: the renderer for saved logs, prints what the run printed or
+*              turns it into a timeline.
  */
-void* commercial_aircraft(void *ai_ptr) 
+static int log_replay(const char *filename, const char *timeline_to)
 {
-  aircraft_info *ai = (aircraft_info*)ai_ptr;
-  
-  /* Record arrival time for fuel tracking */
-  ai->arrival_timestamp = time(NULL);
+  unsigned char header[LOG_HEADER_SIZE];
+  log_event ev;
+  FILE *in;
 
-  /* Request runway access */
-  commercial_enter(ai);
+  if ((in = fopen(filename, "rb")) == NULL) {
+    printf("Cannot open event log %s for reading.\n", filename);
+    return 1;
+  }
+  if (fread(header, 1, LOG_HEADER_SIZE, in) != LOG_HEADER_SIZE || memcmp(header, LOG_MAGIC, 4) != 0
+      || header[4] != LOG_VERSION || header[8] != sizeof(log_event)) {
+    printf("%s is not an event log written by this version of runway.\n", filename);
+    fclose(in);
+    return 1;
+  }
+  event_log.runways = header[9];
+  if (timeline_to != NULL && timeline_begin(timeline_to, header[9], header[10]) != 0) {
+    fclose(in);
+    return 1;
+  }
+  while (fread(&ev, sizeof(ev), 1, in) == 1) {
+    if (event_log.timeline != NULL) {
+      timeline_render(&ev, event_log.timeline);
+    } else {
+      log_render(&ev, stdout);
+    }
+  }
+  timeline_end();
+  fclose(in);
+  return 0;
+}
 
-  printf("Commercial aircraft %d (fuel: %ds) is now on the runway (direction: %s)\n", 
-         ai->aircraft_id, ai->fuel_reserve,
-         current_direction == NORTH ? "NORTH" : "SOUTH");
+/*** Statistics ***/
 
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway == 0 ); // Commercial and cargo cannot mix
+/* Wait times (arrival until admission) go into log-linear histograms in the
+ * style of HdrHistogram: values below 2 * HIST_SUB ns have a bucket each, above
+ * that every power of two is split into HIST_SUB buckets, so any recorded value
+ * is within 1% of its bucket whatever its magnitude, and recording is a
+ * single increment. Runway occupancy is integrated over time on every change,
+ * and the time spent draining the runway for and then performing direction
+ * switches and controller breaks is added up. Every runway keeps its own
+ * figures under its own lock; print_stats() adds them up at the end.
+ */
+
+#define HIST_SUB_BITS 7
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  ((64 - HIST_SUB_BITS) * HIST_SUB)
+
+#define LOCK_SAMPLE  16          /* Time one in this many lock holds */
+
+/* decisions -R records and -P replays, besides PAUSE_SWITCH and PAUSE_BREAK */
+#define DECIDE_ADMIT   2         /* An aircraft gets the runway */
+#define DECIDE_DRAINED 3         /* The runway is empty and the switch or break starts */
+#define DECIDE_ASSIGN  4         /* An aircraft is sent to a runway; recorded per aircraft */
+
+typedef struct
+{
+  uint64_t count[HIST_BUCKETS];
+  uint64_t total;
+  int64_t max;
+  int64_t sum;
+} histogram;
+
+typedef struct
+{
+  int count;
+  int early;               // breaks taken before the controller limit was reached
+  int64_t drain_ns;        // runway closed to new aircraft, last ones still finishing
+  int64_t pause_ns;        // runway empty: switching or controller away
+  int64_t overlap_ns;      // breaks: part of drain_ns + pause_ns spent on a switch as well
+  int64_t started;         // when the current pause began draining
+  int64_t drained;         // when the runway was empty for it
+  int active;              // the pause is in progress
+} pause_stats;
+
+typedef struct
+{
+  histogram wait[3];                             // per aircraft type
+  int64_t occupancy_ns[CAPACITY_MAX + 1]; // time spent with 0, 1, 2 aircraft on the runway
+  int64_t last_change;                           // time of the last occupancy change
+  int on_runway;                                 // aircraft on the runway since then
+  int64_t slot_wasted_ns;                        // slot time left empty while aircraft waited
+  pause_stats pause[2];                          // PAUSE_SWITCH, PAUSE_BREAK
+  int waiting;                                   // aircraft waiting for the runway
+  int64_t break_lost_ns;                         // a break alone kept waiting aircraft off it
+  int64_t lost_change;                           // time of the last change that bears on that
+  int admitted[3];                               // aircraft admitted so far, per type
+  int deadline_misses[3];                        // ... of which after their deadline had passed
+  unsigned long wakeups;                         // times an aircraft thread woke from a wait
+  unsigned long spurious;                        // ... and still could not enter the runway
+  unsigned long fast;                            // aircraft threads admitted without the wait path
+  int64_t last_cleared;                          // when the last aircraft left the runway
+  int held;                                      // -H: aircraft that joined the holding stack
+  int held_peak;                                 // ... the most holding at once
+  int diverted[2];                               // ... turned away instead: HOLD_FULL, HOLD_FUEL
+} runway_stats;
+
+/* a mutex that keeps count of how it is used */
+typedef struct
+{
+  pthread_mutex_t mutex;
+  uint64_t acquired;       // times it was taken, including after waits
+  uint64_t contended;      // ... of which it was held by someone else
+  int64_t wait_ns;         // time spent waiting for it when contended
+  uint64_t sampled;        // holds that were timed, one in LOCK_SAMPLE
+  int64_t hold_ns;         // total time of the timed holds
+  int64_t hold_max;        // longest timed hold
+  int64_t since;           // when the current hold began, 0 if not timed
+} sim_lock;
+
+static int hist_index(int64_t v)
+{
+  int msb;
+  int shift;
+
+  if (v < 2 * HIST_SUB) {
+    return v < 0 ? 0 : (int)v;
+  }
+  msb = 63 - __builtin_clzll((unsigned long long)v);
+  shift = msb - HIST_SUB_BITS;
+  return (shift + 1) * HIST_SUB + (int)(v >> shift) - HIST_SUB;
+}
+
+/* largest value that falls into a bucket */
+static int64_t hist_value(int index)
+{
+  int shift;
+
+  if (index < 2 * HIST_SUB) {
+    return index;
+  }
+  shift = index / HIST_SUB - 1;
+  return ((int64_t)(index % HIST_SUB + HIST_SUB + 1) << shift) - 1;
+}
+
+static void hist_record(histogram *h, int64_t v)
+{
+  h->count[hist_index(v)] = h->count[hist_index(v)] + 1;
+  h->total = h->total + 1;
+  h->sum = h->sum + v;
+  if (v > h->max) {
+    h->max = v;
+  }
+}
+
+/* value at or below which the given fraction of the recorded values lie */
+static int64_t hist_percentile(const histogram *h, double fraction)
+{
+  uint64_t rank = (uint64_t)(fraction * h->total + 0.999999);
+  uint64_t seen = 0;
+
+  if (rank == 0) {
+    rank = 1;
+  }
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen = seen + h->count[i];
+    if (seen >= rank) {
+      int64_t v = hist_value(i);
+      return v < h->max ? v : h->max;
+    }
+  }
+  return h->max;
+}
+
+static void hist_merge(histogram *into, const histogram *from)
+{
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    into->count[i] = into->count[i] + from->count[i];
+  }
+  into->total = into->total + from->total;
+  into->sum = into->sum + from->sum;
+  if (from->max > into->max) {
+    into->max = from->max;
+  }
+}
+
+/* accounts the time since the last change at the current occupancy, then adds delta
+ * aircraft to it; call on every change of the occupancy or the number of waiting aircraft */
+static void stats_occupancy(runway_stats *s, int delta, int64_t now)
+{
+  s->occupancy_ns[s->on_runway] = s->occupancy_ns[s->on_runway] + (now - s->last_change);
+  if (s->waiting > 0) {
+    s->slot_wasted_ns = s->slot_wasted_ns + (params.capacity - s->on_runway) * (now - s->last_change);
+  }
+  s->on_runway = s->on_runway + delta;
+  s->last_change = now;
+}
+
+/* accounts runway time lost to a break since the last call; call before the
+ * pauses or the number of waiting aircraft change */
+static void stats_break_lost(runway_stats *s, int64_t now)
+{
+  if (s->pause[PAUSE_BREAK].active && !s->pause[PAUSE_SWITCH].active && s->waiting > 0) {
+    s->break_lost_ns = s->break_lost_ns + (now - s->lost_change);
+  }
+  s->lost_change = now;
+}
+
+/* the controller has closed the runway to new aircraft for a switch or a break */
+static void stats_pause_begin(runway_stats *s, int kind)
+{
+  s->pause[kind].started = sim_now();
+  stats_break_lost(s, s->pause[kind].started);
+  s->pause[kind].active = 1;
+}
+
+/* ... the runway is empty now ... */
+static void stats_pause_drained(runway_stats *s, int kind)
+{
+  pause_stats *p = &s->pause[kind];
+
+  p->drained = sim_now();
+  p->drain_ns = p->drain_ns + (p->drained - p->started);
+}
+
+/* ... and open again. A switch during a break is runway time the break did not cost. */
+static void stats_pause_end(runway_stats *s, int kind)
+{
+  pause_stats *p = &s->pause[kind];
+  pause_stats *brk = &s->pause[PAUSE_BREAK];
+  int64_t now = sim_now();
+
+  p->count = p->count + 1;
+  p->pause_ns = p->pause_ns + (now - p->drained);
+  stats_break_lost(s, now);
+  p->active = 0;
+  if (kind == PAUSE_SWITCH && brk->active) {
+    brk->overlap_ns = brk->overlap_ns + (now - (brk->started > p->started ? brk->started : p->started));
+  }
+}
+
+static void lock_init(sim_lock *l)
+{
+  memset(l, 0, sizeof(*l));
+  pthread_mutex_init(&l->mutex, NULL);
+}
+
+/* starts timing every LOCK_SAMPLE-th hold; call just after taking the lock */
+static void lock_taken(sim_lock *l)
+{
+  l->acquired = l->acquired + 1;
+  l->since = (l->acquired % LOCK_SAMPLE == 0) ? monotonic_ns() : 0;
+}
+
+/* 
+* Function: lock_acquire
+* Parameters: l - lock to take
+* Returns: void
+* Description: takes a lock. Uncontended this is one trylock; otherwise the time
+*              until the lock is free counts as contention. All simulation code
+*              goes through these lock_* helpers so the statistics can say how
+*              long the critical sections are. Hold times are sampled, as
+*              reading the clock twice per hold would cost more than most holds.
+ */
+static void lock_acquire(sim_lock *l)
+{
+  if (pthread_mutex_trylock(&l->mutex) != 0) {
+    int64_t start = monotonic_ns();
+
+    pthread_mutex_lock(&l->mutex);
+    l->contended = l->contended + 1;
+    l->wait_ns = l->wait_ns + (monotonic_ns() - start);
+  }
+  lock_taken(l);
+}
+
+/* ends the current hold; call while still holding the lock */
+static void lock_held(sim_lock *l)
+{
+  int64_t held;
+
+  if (l->since == 0) {
+    return;
+  }
+  held = monotonic_ns() - l->since;
+  l->sampled = l->sampled + 1;
+  l->hold_ns = l->hold_ns + held;
+  if (held > l->hold_max) {
+    l->hold_max = held;
+  }
+}
+
+static void lock_release(sim_lock *l)
+{
+  lock_held(l);
+  pthread_mutex_unlock(&l->mutex);
+}
+
+/* waits on cond, until the given monotonic time if not NULL; the lock is not held meanwhile */
+static void lock_wait(sim_lock *l, pthread_cond_t *cond, const struct timespec *until)
+{
+  lock_held(l);
+  if (until != NULL) {
+    pthread_cond_timedwait(cond, &l->mutex, until);
+  } else {
+    pthread_cond_wait(cond, &l->mutex);
+  }
+  lock_taken(l);
+}
+
+/* adds the counts of one lock to a running total */
+static void lock_merge(sim_lock *into, const sim_lock *from)
+{
+  into->acquired = into->acquired + from->acquired;
+  into->contended = into->contended + from->contended;
+  into->wait_ns = into->wait_ns + from->wait_ns;
+  into->sampled = into->sampled + from->sampled;
+  into->hold_ns = into->hold_ns + from->hold_ns;
+  if (from->hold_max > into->hold_max) {
+    into->hold_max = from->hold_max;
+  }
+}
+
+static double seconds(int64_t ns)
+{
+  return (double)ns / NSEC_PER_SEC;
+}
+
+/*** Hierarchical timer wheel ***/
+
+/* Deadline timers for waiting aircraft. Four levels of 64 slots each cover
+ * WHEEL_SLOTS^4 ticks (about 19 days at 100 ms); a timer sits in the level
+ * whose span covers its distance from now and is cascaded down as the wheel
+ * turns. Arming and cancelling are O(1) list operations, and a per-level
+ * occupancy bitmap lets the wheel skip empty stretches of time instead of
+ * visiting every tick. Every runway has a wheel of its own for the aircraft
+ * assigned to it; callers must hold that runway's lock.
+ */
+
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1 << WHEEL_BITS)        /* Slots per level */
+#define WHEEL_LEVELS 4
+#define WHEEL_TICK   (NSEC_PER_SEC / 10)      /* Timer resolution: 100 ms */
+
+typedef struct wheel_timer
+{
+  struct wheel_timer *next;  // neighbours in the slot's circular list
+  struct wheel_timer *prev;
+  int64_t expires;           // tick at which the timer fires
+  int level;                 // level and slot the timer is linked into
+  int slot;
+  void (*fire)(struct wheel_timer *);  // called once the timer expires
+} wheel_timer;
+
+typedef struct
+{
+  int64_t tick;                                   // next tick to be processed
+  int armed;                                      // number of armed timers
+  wheel_timer slot[WHEEL_LEVELS][WHEEL_SLOTS];    // list heads
+  uint64_t occupied[WHEEL_LEVELS];                // bit set for every non-empty slot
+} timer_wheel;
+
+static void wheel_init(timer_wheel *wheel)
+{
+  memset(wheel, 0, sizeof(*wheel));
+  for (int level = 0; level < WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < WHEEL_SLOTS; slot++) {
+      wheel->slot[level][slot].next = &wheel->slot[level][slot];
+      wheel->slot[level][slot].prev = &wheel->slot[level][slot];
+    }
+  }
+}
+
+static int timer_armed(const wheel_timer *t)
+{
+  return t->next != NULL;
+}
+
+/* links a timer into the slot matching its distance from the current tick */
+static void wheel_link(timer_wheel *wheel, wheel_timer *t)
+{
+  int64_t delta = t->expires - wheel->tick;
+  int level = 0;
+  wheel_timer *head;
+
+  if (delta < 0) {
+    t->expires = wheel->tick;   // overdue: fire on the next tick processed
+    delta = 0;
+  }
+  while (level < WHEEL_LEVELS - 1 && delta >= (int64_t)1 << (WHEEL_BITS * (level + 1))) {
+    level = level + 1;
+  }
+  if (delta >= (int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) {
+    t->expires = wheel->tick + ((int64_t)1 << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+  }
+
+  t->level = level;
+  t->slot = (int)((t->expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+  head = &wheel->slot[level][t->slot];
+  t->next = head;
+  t->prev = head->prev;
+  head->prev->next = t;
+  head->prev = t;
+  wheel->occupied[level] |= (uint64_t)1 << t->slot;
+}
+
+static void wheel_unlink(timer_wheel *wheel, wheel_timer *t)
+{
+  wheel_timer *head = &wheel->slot[t->level][t->slot];
+
+  t->prev->next = t->next;
+  t->next->prev = t->prev;
+  t->next = t->prev = NULL;
+  if (head->next == head) {
+    wheel->occupied[t->level] &= ~((uint64_t)1 << t->slot);
+  }
+}
+
+/* arms a timer to fire at the given simulation time (rounded up to a tick) */
+static void timer_arm(timer_wheel *wheel, wheel_timer *t, int64_t when_ns, void (*fire)(wheel_timer *))
+{
+  t->expires = (when_ns + WHEEL_TICK - 1) / WHEEL_TICK;
+  t->fire = fire;
+  wheel_link(wheel, t);
+  wheel->armed = wheel->armed + 1;
+}
+
+/* cancels a timer; harmless if it is not armed */
+static void timer_cancel(timer_wheel *wheel, wheel_timer *t)
+{
+  if (timer_armed(t)) {
+    wheel_unlink(wheel, t);
+    wheel->armed = wheel->armed - 1;
+  }
+}
+
+/* moves every timer of a higher-level slot down to the level it now belongs in */
+static void wheel_cascade(timer_wheel *wheel, int level, int slot)
+{
+  wheel_timer *head = &wheel->slot[level][slot];
+
+  while (head->next != head) {
+    wheel_timer *t = head->next;
+    wheel_unlink(wheel, t);
+    wheel_link(wheel, t);
+  }
+}
+
+/* 
+* Function: wheel_advance
+* Parameters: wheel - the wheel to turn
+*             now_ns - current simulation time
+* Returns: void
+* Description: fires, in tick order, every timer that expires at or before now.
+*              Whenever the level 0 index wraps the next slot of each higher level
+*              is cascaded down first. Stretches with nothing in level 0 are
+*              skipped up to the next cascade point. Caller must hold the
+*              runway lock.
+ */
+static void wheel_advance(timer_wheel *wheel, int64_t now_ns)
+{
+  int64_t target = now_ns / WHEEL_TICK;
+
+  while (wheel->armed > 0 && wheel->tick <= target) {
+    int index = (int)(wheel->tick & (WHEEL_SLOTS - 1));
+    wheel_timer *head = &wheel->slot[0][index];
+
+    if (index == 0) {
+      for (int level = 1; level < WHEEL_LEVELS; level++) {
+        int slot = (int)((wheel->tick >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+        wheel_cascade(wheel, level, slot);
+        if (slot != 0) {
+          break;
+        }
+      }
+    }
+
+    if ((wheel->occupied[0] >> index) == 0) {
+      // nothing due this round: jump to the next cascade point, but never past
+      // now, or a timer armed later for the skipped ticks would fire late
+      int64_t next = (wheel->tick | (WHEEL_SLOTS - 1)) + 1;
+      wheel->tick = next <= target ? next : target + 1;
+      continue;
+    }
+    while (head->next != head) {
+      wheel_timer *t = head->next;
+      wheel_unlink(wheel, t);
+      wheel->armed = wheel->armed - 1;
+      t->fire(t);
+    }
+    wheel->tick = wheel->tick + 1;
+  }
+  if (wheel->tick <= target) {
+    wheel->tick = target + 1;  // nothing armed: catch up in one step
+  }
+}
+
+/* 
+* Function: wheel_next_ns
+* Parameters: wheel - the wheel to look at
+* Returns: int64_t - simulation time at which wheel_advance() next has work, or -1
+* Description: the next occupied level 0 tick of the current round, otherwise the
+*              next cascade point. Used to bound how long the controller or the
+*              event engine may sleep. Caller must hold the runway lock.
+ */
+static int64_t wheel_next_ns(const timer_wheel *wheel)
+{
+  int index = (int)(wheel->tick & (WHEEL_SLOTS - 1));
+  uint64_t ahead = wheel->occupied[0] >> index;
+
+  if (wheel->armed == 0) {
+    return -1;
+  }
+  if (ahead != 0) {
+    return (wheel->tick + __builtin_ctzll(ahead)) * WHEEL_TICK;
+  }
+  return ((wheel->tick | (WHEEL_SLOTS - 1)) + 1) * WHEEL_TICK;
+}
+
+typedef struct aircraft_info
+{
+  int arrival_time;         // milliseconds between the arrival of this aircraft and the previous aircraft
+  int runway_time;          // milliseconds the aircraft needs to spend on the runway
+  int aircraft_id;
+  int aircraft_type;        // COMMERCIAL, CARGO, or EMERGENCY
+  struct runway *runway;    // runway the aircraft was assigned to on arrival
+  int fuel_reserve;         // Randomly assigned fuel reserve (FUEL_MIN to FUEL_MAX seconds)
+  int64_t arrival_ns;       // simulation time of arrival, in nanoseconds
+  int64_t deadline;         // simulation time at which fuel or the emergency window runs out
+  int64_t queue_key;        // wait queue order: arrival order or deadline, see queue_push()
+  int heap_pos;             // index in its wait queue heap, -1 if not queued
+  int critical;             // deadline is near: goes ahead of everyone else waiting
+  wheel_timer deadline_timer; // fires in the last DEADLINE_SHARE-th of the window before the deadline
+  int state;                // AC_* state
+  int slot;                 // -A: the client's admission slot
+  pthread_cond_t cond;      // signalled when a waiting aircraft thread is admitted
+  struct aircraft_info *next_free; // arena free list link while the record is unused
+} aircraft_info;
+
+typedef struct
+{
+  aircraft_info **heap;     // binary min-heap ordered by queue_before()
+  int len;
+  int cap;
+} aircraft_heap;
+
+typedef struct
+{
+  aircraft_heap pending;    // aircraft that can still make their deadline
+  aircraft_heap overdue;    // edf policy only: aircraft whose deadline has already passed
+} wait_queue;
+
+/* The admission state of a runway is packed into one word: how many aircraft
+ * are on it, in total and per type, its direction, and whether it is closed for
+ * a switch or a break. It is only ever changed with atomic operations, so an
+ * aircraft can be let on or off with a single compare-and-swap and every reader
+ * sees a consistent snapshot. STATE_QUEUED is set while aircraft are waiting;
+ * they go first, so it sends newcomers down the wait path. STATE_BREAK_NEAR
+ * does the same once the next break is no more than a runway's worth of
+ * aircraft away: the fast path does not count aircraft toward the break until
+ * it has taken their slots, so only the wait path can stop at the limit.
+ */
+#define STATE_COUNT_BITS 8                          // per count, enough for CAPACITY_MAX
+#define STATE_SOUTH      ((uint64_t)1 << 32)        // direction is SOUTH, else NORTH
+#define STATE_SWITCHING  ((uint64_t)1 << 33)        // direction switch in progress
+#define STATE_BREAK      ((uint64_t)1 << 34)        // controller on break
+#define STATE_QUEUED     ((uint64_t)1 << 35)        // aircraft are waiting
+#define STATE_BREAK_NEAR ((uint64_t)1 << 36)        // the controller limit is within capacity
+
+/* Everything about one runway. state has a cache line to itself; the fields
+ * from lock down to stats are protected by lock in the threaded simulation; the
+ * event engine handles one event at a time under the global lock instead and
+ * leaves these alone. load is also read without any lock by runway_assign(), so
+ * it is only changed with atomic operations.
+ */
+typedef struct runway
+{
+  uint64_t state __attribute__((aligned(64))); // STATE_* word, see runway_state()
+  int id;                           // index in runways[]
+  sim_lock lock __attribute__((aligned(64))); // protects this runway's state
+  pthread_cond_t cond_check;        // broadcast wakeups for its waiting aircraft
+  pthread_cond_t cond_controller;   // its controller has a decision to make
+  pthread_t controller_tid;
+  int controller;                   // CTRL_* state of its controller in the event engine
+  int aircraft_since_break;         /* Aircraft processed since last controller break */
+  int consecutive_direction;        /* Consecutive aircraft in current direction */
+  int commercial_waiting;
+  int cargo_waiting;
+  int emergency_waiting;
+  int last_aircraft_type;
+  int consecutive_type_count;
+  int critical_waiting[3];          /* Waiting aircraft close to their deadline, per type */
+  int64_t direction_since;          /* Time the runway was last turned to its direction */
+  int64_t runway_ms;                /* Runway time of every aircraft admitted, for the planner */
+  int64_t busy_until;               /* Time the last aircraft now on the runway will be done */
+  int64_t waiting_ms[3];            /* Runway time the waiting aircraft need, per type, for -H */
+  int64_t finish_ns[CAPACITY_MAX];  /* Time each aircraft on the runway is done, for -H; past once it is */
+  int load;                         /* Aircraft assigned here that have not cleared yet */
+  int assigned;                     /* Aircraft ever assigned here */
+  wait_queue queue[3];              /* Aircraft waiting for the runway, one queue per type */
+  timer_wheel wheel;                /* Deadline timers of the aircraft waiting here */
+  runway_stats stats;
+} runway;
+
+static runway runways[MAX_RUNWAYS];
+
+/* a consistent snapshot of the runway's admission state */
+static uint64_t runway_state(const runway *rw)
+{
+  return __atomic_load_n(&rw->state, __ATOMIC_ACQUIRE);
+}
+
+/* aircraft on the runway in a snapshot: of one type, or in total if type < 0 */
+static int state_count(uint64_t s, int type)
+{
+  return (int)(s >> (STATE_COUNT_BITS * (type + 1))) & ((1 << STATE_COUNT_BITS) - 1);
+}
+
+static int state_direction(uint64_t s)
+{
+  return (s & STATE_SOUTH) ? SOUTH : NORTH;
+}
+
+/* what one more aircraft of the given type on the runway adds to the state */
+static uint64_t state_one(int type)
+{
+  return (uint64_t)1 | (uint64_t)1 << (STATE_COUNT_BITS * (type + 1));
+}
+
+static int on_runway(const runway *rw)
+{
+  return state_count(runway_state(rw), -1);
+}
+
+static int runway_direction(const runway *rw)
+{
+  return state_direction(runway_state(rw));
+}
+
+/* 
+* Function: state_check
+* Parameters: s - snapshot of a runway's state
+*             type - type of an aircraft on the runway, or -1 once it has left
+* Returns: void
+* Description: checks the runway invariants on one consistent snapshot: no more
+*              aircraft than the capacity, the counts per type add up to the
+*              total, commercial and cargo never share the runway, and the
+*              caller's own aircraft is counted while it is on.
+ */
+static void state_check(uint64_t s, int type)
+{
+  int total      = state_count(s, -1);
+  int commercial = state_count(s, COMMERCIAL);
+  int cargo      = state_count(s, CARGO);
+  int emergency  = state_count(s, EMERGENCY);
+
+  if (total > params.capacity || commercial + cargo + emergency != total
+      || (commercial > 0 && cargo > 0) || (type >= 0 && state_count(s, type) == 0)) {
+    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", total, params.capacity);
+    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n",
+           commercial, cargo, emergency, state_direction(s) == NORTH ? "NORTH" : "SOUTH");
+  }
+  assert(total <= params.capacity);
+  assert(commercial + cargo + emergency == total);
+  assert(commercial == 0 || cargo == 0); // Commercial and cargo cannot mix
+  assert(type < 0 || state_count(s, type) > 0);
+}
+
+/* sets or clears one of the STATE_* flags */
+static void runway_flag(runway *rw, uint64_t flag, int set)
+{
+  if (set) {
+    __atomic_fetch_or(&rw->state, flag, __ATOMIC_ACQ_REL);
+  } else {
+    __atomic_fetch_and(&rw->state, ~flag, __ATOMIC_ACQ_REL);
+  }
+}
+
+/* sets aircraft_since_break and STATE_BREAK_NEAR along with it. Caller must
+ * hold the runway lock. */
+static void runway_since_break(runway *rw, int since_break)
+{
+  int near = since_break + params.capacity >= params.controller_limit;
+
+  rw->aircraft_since_break = since_break;
+  if (near != ((runway_state(rw) & STATE_BREAK_NEAR) != 0)) {
+    runway_flag(rw, STATE_BREAK_NEAR, near);
+  }
+}
+
+/* A scheduling policy decides who gets the runway and when the controller
+ * turns it around or goes on break; the threaded simulation and the event
+ * engine both ask it through these callbacks. -s picks one from policies[],
+ * -d and -b swap in another should_switch or should_break.
+ */
+typedef struct
+{
+  const char *name;                                 // as given to -s
+  void (*on_arrival)(aircraft_info *ai);            // sets the aircraft's queue_key
+  aircraft_info *(*pick_next)(runway *rw);          // next admissible waiter, still queued
+  int (*should_switch)(const runway *rw);           // turn the runway around now
+  int (*should_break)(const runway *rw, int switching); // go on break now, or with this switch
+} sched_policy;
+
+static sched_policy policy;
+
+static void decision_made(const runway *rw, int kind, int aircraft_id);
+static int replay_pending(const runway *rw);
+static int replay_holds_drain(const runway *rw);
+static runway *replay_runway(int aircraft_id);
+static int plan_forecast(void);
+
+/* arena, trace and simulation_done; in the event engine also every runway */
+static sim_lock lock = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+/* Aircraft records come from an arena of ARENA_SLAB-sized slabs. A record is
+ * taken when its aircraft is read from the trace and goes back on the free list
+ * once the aircraft has cleared the runway, so memory follows the number of
+ * aircraft in flight rather than the length of the trace. Callers must hold lock.
+ */
+typedef struct aircraft_slab
+{
+  struct aircraft_slab *next;        // previously allocated slab
+  aircraft_info record[ARENA_SLAB];
+} aircraft_slab;
+
+static struct
+{
+  aircraft_slab *slabs;      // every slab allocated so far
+  aircraft_info *free_list;  // records ready for reuse
+  int in_flight;             // records currently handed out
+  int peak;                  // most records handed out at once
+} arena;
+
+/* takes a zeroed record from the arena, growing it by a slab when it runs dry */
+static aircraft_info *aircraft_alloc(void)
+{
+  aircraft_info *ai;
+
+  if (arena.free_list == NULL) {
+    aircraft_slab *slab = malloc(sizeof(aircraft_slab));
+
+    if (slab == NULL) {
+      printf("runway: out of memory for %d aircraft records\n", arena.in_flight + ARENA_SLAB);
+      exit(1);
+    }
+    slab->next = arena.slabs;
+    arena.slabs = slab;
+    for (int i = ARENA_SLAB - 1; i >= 0; i--) {
+      slab->record[i].next_free = arena.free_list;
+      arena.free_list = &slab->record[i];
+    }
+  }
+
+  ai = arena.free_list;
+  arena.free_list = ai->next_free;
+  memset(ai, 0, sizeof(*ai));
+  arena.in_flight = arena.in_flight + 1;
+  if (arena.in_flight > arena.peak) {
+    arena.peak = arena.in_flight;
+  }
+  return ai;
+}
+
+/* returns a record to the arena for the next aircraft to use */
+static void aircraft_free(aircraft_info *ai)
+{
+  ai->next_free = arena.free_list;
+  arena.free_list = ai;
+  arena.in_flight = arena.in_flight - 1;
+}
+
+/* gives all slabs back to the system once the simulation is over */
+static void arena_destroy(void)
+{
+  while (arena.slabs != NULL) {
+    aircraft_slab *slab = arena.slabs;
+    arena.slabs = slab->next;
+    free(slab);
+  }
+  memset(&arena, 0, sizeof(arena));
+}
+
+static void aircraft_deadline_timer(wheel_timer *t);
+
+/* 
+* Function: aircraft_arrive
+* Parameters: ai - aircraft that has just arrived at the airport
+* Returns: void
+* Description: stamps the arrival time and works out the aircraft's deadline: the
+*              moment its fuel reserve runs out, or for an emergency the end of the
+*              EMERGENCY_TIMEOUT admission window if that comes first. Arms the
+*              timer that escalates the aircraft once all but 1/DEADLINE_SHARE of
+*              that window has passed, so one with the smallest reserve is not
+*              critical from the moment it arrives.
+*              Caller must hold the lock of the aircraft's runway.
+ */
+static void aircraft_arrive(aircraft_info *ai)
+{
+  int64_t window = ai->fuel_reserve;
+
+  if (ai->aircraft_type == EMERGENCY && EMERGENCY_TIMEOUT < window) {
+    window = EMERGENCY_TIMEOUT;
+  }
+  ai->arrival_ns = sim_now();
+  ai->deadline = ai->arrival_ns + window * NSEC_PER_SEC;
+  log_emit(LOG_ARRIVED, ai->runway->id, ai->aircraft_type, ai->aircraft_id, ai->fuel_reserve, 0);
+  ai->heap_pos = -1;
+  ai->critical = 0;
+  ai->deadline_timer.next = NULL;
+  timer_arm(&ai->runway->wheel, &ai->deadline_timer,
+            ai->deadline - window * NSEC_PER_SEC / DEADLINE_SHARE, aircraft_deadline_timer);
+}
+
+/* 
+* Function: state_admits
+* Parameters: s - snapshot of a runway's state
+*             type - COMMERCIAL, CARGO or EMERGENCY
+* Returns: int - nonzero if an aircraft of that type may enter the runway now
+* Description: admission rule shared by the *_enter functions and the event
+*              engine. Commercial aircraft need a NORTH runway, cargo a SOUTH one,
+*              emergencies may use either; nobody enters while the runway is full,
+*              the direction is being switched or the controller is on break.
+*              Decided on a snapshot of the runway state, so it also serves the
+*              lock-free fast path in runway_enter().
+ */
+static int state_admits(uint64_t s, int type)
+{
+  if (state_count(s, -1) >= params.capacity || (s & (STATE_SWITCHING | STATE_BREAK))) {
+    return 0;
+  }
+  if (type == COMMERCIAL) {
+    return state_direction(s) == NORTH;
+  }
+  if (type == CARGO) {
+    return state_direction(s) == SOUTH;
+  }
+  return 1;
+}
+
+/* state_admits() for the runway now, which also holds newcomers back once the
+ * controller has handled params.controller_limit aircraft since the last break.
+ * Caller must hold the runway lock. */
+static int runway_admissible(const runway *rw, int type)
+{
+  return rw->aircraft_since_break < params.controller_limit && state_admits(runway_state(rw), type);
+}
+
+/* 
+* Function: runway_fits
+* Parameters: rw - runway that is draining for a switch or a break
+*             ai - a waiting aircraft
+* Returns: int - nonzero if the aircraft may take a free slot anyway
+* Description: under PACK_FILL a slot left free while the runway drains is a
+*              bin of the time until the last aircraft on the runway is done.
+*              An aircraft for the current direction fits if its runway time
+*              ends within it, so the switch or break starts no later than it
+*              would have. The controller limit still holds. Caller must hold
+*              the runway lock.
+ */
+static int runway_fits(const runway *rw, const aircraft_info *ai)
+{
+  int type = ai->aircraft_type;
+  uint64_t s = runway_state(rw);
+
+  if (pack_mode != PACK_FILL || !(s & (STATE_SWITCHING | STATE_BREAK))
+      || state_count(s, -1) == 0 || state_count(s, -1) >= params.capacity
+      || rw->aircraft_since_break >= params.controller_limit) {
+    return 0;
+  }
+  if ((type == COMMERCIAL && state_direction(s) != NORTH)
+      || (type == CARGO && state_direction(s) != SOUTH)) {
+    return 0;
+  }
+  return sim_now() + ai->runway_time * NSEC_PER_MSEC <= rw->busy_until;
+}
+
+/* 
+* Function: runway_occupy
+* Parameters: ai - aircraft that has just been admitted
+* Returns: void
+* Description: updates the runway counters for an admitted aircraft, whose slot
+*              has already been taken in the runway state. Emergencies count
+*              toward the direction and break limits but not toward the
+*              consecutive aircraft type streak. Records how long the aircraft
+*              waited. Caller must hold the runway lock.
+ */
+static void runway_occupy(aircraft_info *ai)
+{
+  runway *rw = ai->runway;
+  int64_t now = sim_now();
+  int slot = 0;
+
+  decision_made(rw, DECIDE_ADMIT, ai->aircraft_id);
+  stats_occupancy(&rw->stats, 1, now);
+  hist_record(&rw->stats.wait[ai->aircraft_type], now - ai->arrival_ns);
+
+  runway_since_break(rw, rw->aircraft_since_break + 1);
+  rw->consecutive_direction = rw->consecutive_direction + 1;
+  rw->runway_ms             = rw->runway_ms + ai->runway_time;
+  if (now + ai->runway_time * NSEC_PER_MSEC > rw->busy_until) {
+    rw->busy_until = now + ai->runway_time * NSEC_PER_MSEC;
+  }
+  // the earliest entry belongs to an aircraft that is done, the slot this one took
+  for (int i = 1; i < params.capacity; i++) {
+    if (rw->finish_ns[i] < rw->finish_ns[slot]) {
+      slot = i;
+    }
+  }
+  rw->finish_ns[slot] = now + ai->runway_time * NSEC_PER_MSEC;
+
+  timer_cancel(&rw->wheel, &ai->deadline_timer);
+  if (ai->critical) {
+    rw->critical_waiting[ai->aircraft_type] = rw->critical_waiting[ai->aircraft_type] - 1;
+  }
+
+  rw->stats.admitted[ai->aircraft_type] = rw->stats.admitted[ai->aircraft_type] + 1;
+  if (now > ai->deadline) {
+    rw->stats.deadline_misses[ai->aircraft_type] = rw->stats.deadline_misses[ai->aircraft_type] + 1;
+  }
+
+  if (ai->aircraft_type == EMERGENCY) {
+    return;
+  }
+
+  // tracking consecutive aircraft types
+  if (ai->aircraft_type == rw->last_aircraft_type) {
+    rw->consecutive_type_count = rw->consecutive_type_count + 1;
+  } else {
+    rw->last_aircraft_type = ai->aircraft_type;
+    rw->consecutive_type_count = 1;
+  }
+}
+
+/* takes a slot the rules give an aircraft of this type, for an admission under
+ * the runway lock; STATE_QUEUED keeps the fast path off it meanwhile */
+static void runway_take(runway *rw, int type)
+{
+  __atomic_fetch_add(&rw->state, state_one(type), __ATOMIC_ACQ_REL);
+}
+
+/* gives the slot of a departing aircraft back, just before runway_vacate(), so
+ * nobody is counted onto the runway before it is counted off. Caller must hold
+ * the runway lock. */
+static void runway_release(runway *rw, int type)
+{
+  __atomic_fetch_sub(&rw->state, state_one(type), __ATOMIC_ACQ_REL);
+}
+
+/* updates the runway counters for an aircraft that has released its slot.
+ * Caller must hold the runway lock. */
+static void runway_vacate(runway *rw)
+{
+  stats_occupancy(&rw->stats, -1, sim_now());
+  rw->stats.last_cleared = sim_now();
+  __atomic_fetch_sub(&rw->load, 1, __ATOMIC_RELAXED);
+}
+
+/* closes the runway to new aircraft for a switch (PAUSE_SWITCH) or a break
+ * (PAUSE_BREAK); it opens again once that is over. Caller must hold the runway lock. */
+static void runway_close(runway *rw, int kind)
+{
+  runway_flag(rw, kind == PAUSE_SWITCH ? STATE_SWITCHING : STATE_BREAK, 1);
+  stats_pause_begin(&rw->stats, kind);
+  log_emit(LOG_CLOSED, rw->id, -1, -1, kind, 0);
+  decision_made(rw, kind, -1);
+}
+
+/* adjusts the waiting counts the controller looks at for the aircraft's type */
+static void waiting_add(const aircraft_info *ai, int delta)
+{
+  runway *rw = ai->runway;
+  int type = ai->aircraft_type;
+
+  rw->waiting_ms[type] = rw->waiting_ms[type] + delta * ai->runway_time;
+  stats_occupancy(&rw->stats, 0, sim_now());
+  stats_break_lost(&rw->stats, sim_now());
+  rw->stats.waiting = rw->stats.waiting + delta;
+  if ((rw->stats.waiting > 0) != (rw->stats.waiting - delta > 0)) {
+    runway_flag(rw, STATE_QUEUED, rw->stats.waiting > 0);
+  }
+  if (type == COMMERCIAL) {
+    rw->commercial_waiting = rw->commercial_waiting + delta;
+  } else if (type == CARGO) {
+    rw->cargo_waiting = rw->cargo_waiting + delta;
+  } else {
+    rw->emergency_waiting = rw->emergency_waiting + delta;
+  }
+}
+
+/* wait queue order: critical aircraft first, then smaller key, ties in arrival order */
+static int queue_before(const aircraft_info *a, const aircraft_info *b)
+{
+  if (a->critical != b->critical) {
+    return a->critical;
+  }
+  return a->queue_key < b->queue_key
+         || (a->queue_key == b->queue_key && a->aircraft_id < b->aircraft_id);
+}
+
+/* puts ai at index i of the heap and records the position */
+static void heap_place(aircraft_heap *h, int i, aircraft_info *ai)
+{
+  h->heap[i] = ai;
+  ai->heap_pos = i;
+}
+
+static void heap_sift_up(aircraft_heap *h, int i, aircraft_info *ai)
+{
+  while (i > 0 && queue_before(ai, h->heap[(i - 1) / 2])) {
+    heap_place(h, i, h->heap[(i - 1) / 2]);
+    i = (i - 1) / 2;
+  }
+  heap_place(h, i, ai);
+}
+
+static void heap_sift_down(aircraft_heap *h, int i, aircraft_info *ai)
+{
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= h->len) {
+      break;
+    }
+    if (child + 1 < h->len && queue_before(h->heap[child + 1], h->heap[child])) {
+      child = child + 1;
+    }
+    if (!queue_before(h->heap[child], ai)) {
+      break;
+    }
+    heap_place(h, i, h->heap[child]);
+    i = child;
+  }
+  heap_place(h, i, ai);
+}
+
+static void heap_push(aircraft_heap *h, aircraft_info *ai)
+{
+  if (h->len == h->cap) {
+    h->cap = h->cap ? h->cap * 2 : 16;
+    h->heap = realloc(h->heap, h->cap * sizeof(aircraft_info *));
+    if (h->heap == NULL) {
+      printf("runway: out of memory for the wait queue\n");
+      exit(1);
+    }
+  }
+
+  h->len = h->len + 1;
+  heap_sift_up(h, h->len - 1, ai);
+}
+
+/* removes the aircraft at index i; the last element fills the hole */
+static void heap_remove(aircraft_heap *h, int i)
+{
+  aircraft_info *last = h->heap[--h->len];
+
+  h->heap[i]->heap_pos = -1;
+  if (i < h->len) {
+    heap_sift_down(h, i, last);
+    heap_sift_up(h, last->heap_pos, last);
+  }
+}
+
+/* removes and returns the head of a heap */
+static aircraft_info *heap_pop(aircraft_heap *h)
+{
+  aircraft_info *head = h->heap[0];
+
+  heap_remove(h, 0);
+  return head;
+}
+
+/* 
+* Function: queue_push
+* Parameters: ai - aircraft that starts waiting for the runway
+* Returns: void
+* Description: inserts an aircraft into its type's wait queue. The queue is a
+*              priority queue on the key the policy's on_arrival() gives the
+*              aircraft. Caller must hold the runway lock.
+ */
+static void queue_push(aircraft_info *ai)
+{
+  policy.on_arrival(ai);
+  ai->state = AC_WAITING;
+  waiting_add(ai, 1);
+  heap_push(&ai->runway->queue[ai->aircraft_type].pending, ai);
+}
+
+/* number of aircraft waiting in a queue */
+static int queue_length(const wait_queue *q)
+{
+  return q->pending.len + q->overdue.len;
+}
+
+/* the next aircraft of a queue, pending before overdue; NULL if it is empty */
+static aircraft_info *queue_first(const wait_queue *q)
+{
+  if (q->pending.len > 0) {
+    return q->pending.heap[0];
+  }
+  return q->overdue.len > 0 ? q->overdue.heap[0] : NULL;
+}
+
+/* the heap of its type's wait queue that holds a queued aircraft */
+static aircraft_heap *queue_heap_of(wait_queue *q, const aircraft_info *ai)
+{
+  return (ai->heap_pos < q->pending.len && q->pending.heap[ai->heap_pos] == ai)
+         ? &q->pending : &q->overdue;
+}
+
+/* 
+* Function: aircraft_deadline_timer
+* Parameters: t - the aircraft's deadline timer
+* Returns: void
+* Description: timer wheel callback for a waiting aircraft. In the last
+*              1/DEADLINE_SHARE of the time before it runs out of fuel or
+*              reaches the end of its emergency window the aircraft becomes
+*              critical: it moves ahead of everyone else in its wait queue
+*              and, if it needs the other direction, the controller turns the
+*              runway around for it. The timer is re-armed for the deadline
+*              itself; once that passes nothing can save the deadline any more,
+*              so the aircraft loses its priority again rather than hold up
+*              others who can still make theirs. Caller must hold the runway lock.
+ */
+static void aircraft_deadline_timer(wheel_timer *t)
+{
+  aircraft_info *ai = (aircraft_info *)((char *)t - offsetof(aircraft_info, deadline_timer));
+  runway *rw = ai->runway;
+  wait_queue *q = &rw->queue[ai->aircraft_type];
+
+  if (!ai->critical) {
+    ai->critical = 1;
+    rw->critical_waiting[ai->aircraft_type] = rw->critical_waiting[ai->aircraft_type] + 1;
+    timer_arm(&rw->wheel, t, ai->deadline + 1, aircraft_deadline_timer);
+
+    log_emit(LOG_PRIORITY, rw->id, ai->aircraft_type, ai->aircraft_id,
+             ai->aircraft_type == EMERGENCY && ai->fuel_reserve > EMERGENCY_TIMEOUT, 0);
+  } else {
+    ai->critical = 0;
+    rw->critical_waiting[ai->aircraft_type] = rw->critical_waiting[ai->aircraft_type] - 1;
+  }
+
+  // reposition it in whichever heap holds it (threads in broadcast mode are in none)
+  if (ai->heap_pos >= 0) {
+    aircraft_heap *h = queue_heap_of(q, ai);
+    heap_remove(h, ai->heap_pos);
+    heap_push(h, ai);
+  }
+}
+
+/* 
+* Function: runway_pack_next
+* Parameters: rw - runway that may be draining with a free slot
+* Returns: aircraft_info* - the aircraft that was admitted, or NULL if none fits
+* Description: best-fit packing of a draining runway's free slot: of the first
+*              PACK_SCAN entries of every wait queue, takes the aircraft with
+*              the longest runway time that runway_fits(), the earlier in queue
+*              order among equals. Caller must hold the runway lock.
+ */
+static aircraft_info *runway_pack_next(runway *rw)
+{
+  aircraft_heap *best_heap = NULL;
+  aircraft_info *best = NULL;
+  aircraft_info *ai;
+  int type;
+
+  if (pack_mode != PACK_FILL || !(runway_state(rw) & (STATE_SWITCHING | STATE_BREAK))
+      || replay_pending(rw)) {
+    return NULL;
+  }
+  for (type = COMMERCIAL; type <= EMERGENCY; type++) {
+    aircraft_heap *heaps[2] = { &rw->queue[type].pending, &rw->queue[type].overdue };
+
+    for (int k = 0; k < 2; k++) {
+      for (int i = 0; i < heaps[k]->len && i < PACK_SCAN; i++) {
+        ai = heaps[k]->heap[i];
+        if (runway_fits(rw, ai)
+            && (best == NULL || ai->runway_time > best->runway_time
+                || (ai->runway_time == best->runway_time && queue_before(ai, best)))) {
+          best = ai;
+          best_heap = heaps[k];
+        }
+      }
+    }
+  }
+  if (best == NULL) {
+    return NULL;
+  }
+
+  heap_remove(best_heap, best->heap_pos);
+  assert(best->state == AC_WAITING);
+  best->state = AC_ON_RUNWAY;
+  runway_take(rw, best->aircraft_type);
+  runway_occupy(best);
+  waiting_add(best, -1);
+  return best;
+}
+
+/* 
+* Function: runway_admit_next
+* Parameters: rw - runway that may have room
+* Returns: aircraft_info* - the aircraft that was admitted, or NULL if none can be
+* Description: lets the policy's pick_next() choose among the aircraft the
+*              runway accepts right now. The one it picks is removed from its
+*              queue and the runway is occupied on its behalf. While the runway
+*              drains, runway_pack_next() may still fill a slot. Caller must
+*              hold the runway lock.
+ */
+static aircraft_info *runway_admit_next(runway *rw)
+{
+  aircraft_info *ai = policy.pick_next(rw);
+
+  if (ai == NULL) {
+    return runway_pack_next(rw);
+  }
+
+  heap_remove(queue_heap_of(&rw->queue[ai->aircraft_type], ai), ai->heap_pos);
+  assert(ai->state == AC_WAITING);
+  ai->state = AC_ON_RUNWAY;
+  runway_take(rw, ai->aircraft_type);  // still counted as waiting, so nobody overtakes it
+  runway_occupy(ai);
+  waiting_add(ai, -1);
+  return ai;
+}
+
+static int trace_upcoming(int type);
+
+/* 
+* Function: switch_planned
+* Parameters: rw - runway the controller is in charge of
+*             same_waiting, opposite_waiting - aircraft waiting for this and the
+*             other direction, at least one of each
+* Returns: int - nonzero if turning the runway around now saves waiting time
+* Description: the cost model behind -d plan. Each side's batch is what waits
+*              for it plus its share, rounded up, of the trace arrivals due
+*              within PLAN_HORIZON seconds. A batch takes as many rounds of
+*              params.capacity aircraft as it needs, each as long as the mean
+*              runway time so far. Staying makes every opposite aircraft wait
+*              for this side's batch; switching makes this side's batch wait
+*              for the switch and the opposite batch. The runway is turned
+*              around when staying costs more aircraft-seconds of waiting.
+ */
+static int switch_planned(const runway *rw, int same_waiting, int opposite_waiting)
+{
+  int north      = runway_direction(rw) == NORTH;
+  int admitted   = rw->stats.admitted[COMMERCIAL] + rw->stats.admitted[CARGO]
+                   + rw->stats.admitted[EMERGENCY];
+  double mean    = admitted ? (double)rw->runway_ms / admitted : MSEC_PER_SEC;
+  int same       = same_waiting
+                   + (trace_upcoming(north ? COMMERCIAL : CARGO) + num_runways - 1) / num_runways;
+  int opposite   = opposite_waiting
+                   + (trace_upcoming(north ? CARGO : COMMERCIAL) + num_runways - 1) / num_runways;
+  double same_s  = (same + params.capacity - 1) / params.capacity * mean;
+  double other_s = (opposite + params.capacity - 1) / params.capacity * mean;
+
+  return opposite * same_s > same * (params.switch_time + other_s);
+}
+
+/* 
+* Function: switch_forced
+* Parameters: rw - runway the controller is in charge of
+* Returns: int - 1 or 0 if the switch is decided either way, -1 if it is up to the policy
+* Description: the rules every policy keeps. A switch is only justified when
+*              traffic for the opposite direction is waiting. It happens as soon
+*              as nobody is waiting for the current direction, so a lone waiter
+*              for the other direction is never stranded, and a critical
+*              aircraft waiting for the other direction forces a switch unless
+*              one is also waiting for this direction. Caller must hold the
+*              runway lock.
+ */
+static int switch_forced(const runway *rw)
+{
+  int north            = runway_direction(rw) == NORTH;
+  int same_type        = north ? COMMERCIAL : CARGO;
+  int opposite_type    = north ? CARGO : COMMERCIAL;
+  int same_waiting     = north ? rw->commercial_waiting : rw->cargo_waiting;
+  int opposite_waiting = north ? rw->cargo_waiting : rw->commercial_waiting;
+
+  if (opposite_waiting == 0) {
+    return 0;
+  }
+  if (rw->critical_waiting[opposite_type] > 0 && rw->critical_waiting[same_type] == 0) {
+    return 1;
+  }
+  if (same_waiting == 0) {
+    return 1;
+  }
+  return -1;
+}
+
+/*** Scheduling policies ***/
+
+/* arrival order */
+static void fifo_on_arrival(aircraft_info *ai)
+{
+  ai->queue_key = ai->aircraft_id;
+}
+
+/* the deadline: fuel running out or the end of the emergency window */
+static void edf_on_arrival(aircraft_info *ai)
+{
+  ai->queue_key = ai->deadline;
+}
+
+/* the head of every queue the runway accepts right now, first in queue order */
+static aircraft_info *fifo_pick_next(runway *rw)
+{
+  aircraft_info *best = NULL;
+  aircraft_info *ai;
+
+  for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+    if (!runway_admissible(rw, type) || (ai = queue_first(&rw->queue[type])) == NULL) {
+      continue;
+    }
+    if (best == NULL || queue_before(ai, best)) {
+      best = ai;
+    }
+  }
+  return best;
+}
+
+/* 
+* Function: edf_pick_next
+* Parameters: rw - runway that may have room
+* Returns: aircraft_info* - the waiter to admit, NULL if none can go
+* Description: earliest deadline first. Aircraft whose deadline has passed are
+*              first moved from the front of their pending heap to the overdue
+*              heap: a plain EDF queue lets one hopeless aircraft push everybody
+*              behind it past their deadlines too, so overdue aircraft only go
+*              once nobody who can still make it is waiting. Caller must hold
+*              the runway lock.
+ */
+static aircraft_info *edf_pick_next(runway *rw)
+{
+  aircraft_info *best = NULL;
+  aircraft_info *ai;
+  int64_t now = sim_now();
+
+  for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+    wait_queue *q = &rw->queue[type];
+
+    if (!runway_admissible(rw, type)) {
+      continue;
+    }
+    while (q->pending.len > 0 && q->pending.heap[0]->deadline < now) {
+      heap_push(&q->overdue, heap_pop(&q->pending));
+    }
+    if ((ai = queue_first(q)) == NULL) {
+      continue;
+    }
+    if (best == NULL || ((ai->deadline < now) != (best->deadline < now)
+                         ? best->deadline < now : queue_before(ai, best))) {
+      best = ai;
+    }
+  }
+  return best;
+}
+
+/* switches once too many aircraft in a row used one direction or were of one type */
+static int switch_on_limits(const runway *rw)
+{
+  int forced = switch_forced(rw);
+
+  if (forced >= 0) {
+    return forced;
+  }
+  return rw->consecutive_direction >= params.direction_limit || rw->consecutive_type_count >= params.type_limit;
+}
+
+/* switches when switch_planned() says so, or once this direction has had the
+ * runway for params.fairness milliseconds while the other side waits */
+static int switch_on_plan(const runway *rw)
+{
+  int north = runway_direction(rw) == NORTH;
+  int forced = switch_forced(rw);
+
+  if (forced >= 0) {
+    return forced;
+  }
+  return sim_now() - rw->direction_since >= params.fairness * NSEC_PER_MSEC
+         || switch_planned(rw, north ? rw->commercial_waiting : rw->cargo_waiting,
+                           north ? rw->cargo_waiting : rw->commercial_waiting);
+}
+
+/* breaks once params.controller_limit aircraft have been handled, never with a switch */
+static int break_when_due(const runway *rw, int switching)
+{
+  return !switching && rw->aircraft_since_break >= params.controller_limit;
+}
+
+/* 
+* Function: break_early
+* Parameters: rw - runway the controller is in charge of
+*             switching - nonzero if the runway is about to be switched
+* Returns: int - nonzero if the controller should go on break now
+* Description: the break is due once params.controller_limit aircraft have
+*              been handled, but the controller may also go once half of them
+*              have: along with a direction switch, so the two overlap, or if
+*              the runway is empty and nobody is waiting for it, so the break
+*              falls in a lull instead of the next rush. Caller must hold the
+*              runway lock.
+ */
+static int break_early(const runway *rw, int switching)
+{
+  if (rw->aircraft_since_break >= params.controller_limit) {
+    return 1;
+  }
+  if (rw->aircraft_since_break == 0 || 2 * rw->aircraft_since_break < params.controller_limit) {
+    return 0;
+  }
+  return switching || (on_runway(rw) == 0 && rw->commercial_waiting == 0
+                       && rw->cargo_waiting == 0 && rw->emergency_waiting == 0);
+}
+
+/* the policies -s can pick; the first is the default */
+static const sched_policy policies[] = {
+  { "fifo", fifo_on_arrival, fifo_pick_next, switch_on_limits, break_when_due },
+  { "edf",  edf_on_arrival,  edf_pick_next,  switch_on_limits, break_when_due },
+};
+
+/* looks a policy up by name; NULL if there is none */
+static const sched_policy *policy_find(const char *name)
+{
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    if (strcmp(policies[i].name, name) == 0) {
+      return &policies[i];
+    }
+  }
+  return NULL;
+}
+
+/* 
+* Function: runway_assign
+* Parameters: ai - aircraft that has just arrived
+* Returns: runway* - the runway the aircraft will use
+* Description: the assignment layer. Sends the aircraft to the runway where the
+*              fewest aircraft are ahead of it: those assigned there and not yet
+*              cleared, plus ASSIGN_TURN_COST if the runway faces the wrong way
+*              for it. Other runways are looked at without taking their locks;
+*              a stale view can only make the choice less good, and from here
+*              on the aircraft is handled entirely under its runway's lock.
+ */
+static runway *runway_assign(aircraft_info *ai)
+{
+  runway *recorded = replay_runway(ai->aircraft_id);  // -P gives the runway it got before
+  runway *best = recorded != NULL ? recorded : &runways[0];
+  int best_cost = -1;
+
+  for (int i = 0; recorded == NULL && i < num_runways; i++) {
+    runway *rw = &runways[i];
+    int direction = runway_direction(rw);
+    int cost = __atomic_load_n(&rw->load, __ATOMIC_RELAXED);
+
+    if ((ai->aircraft_type == COMMERCIAL && direction != NORTH)
+        || (ai->aircraft_type == CARGO && direction != SOUTH)) {
+      cost = cost + ASSIGN_TURN_COST;
+    }
+    if (best_cost < 0 || cost < best_cost) {
+      best = rw;
+      best_cost = cost;
+    }
+  }
+
+  __atomic_fetch_add(&best->load, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&best->assigned, 1, __ATOMIC_RELAXED);
+  ai->runway = best;
+  decision_made(best, DECIDE_ASSIGN, ai->aircraft_id);
+  return best;
+}
+
+/*** Holding stack ***/
+
+/* Without -H every arrival that cannot go straight onto its runway waits for
+ * it, however long the queue and however little fuel it has. With -H N an
+ * arrival that has to wait first asks for a place in its runway's holding
+ * stack. It is diverted instead if N aircraft are holding there already, or
+ * if its predicted wait is longer than its fuel reserve. Under overload the
+ * queues and the waits then stay bounded, and the aircraft turned away are
+ * the ones that would have run dry anyway. Emergencies always get a place
+ * and do not count towards N.
+ */
+
+/* 
+* Function: holding_predict
+* Parameters: ai - aircraft that has to wait for the runway it was assigned
+* Returns: int64_t - milliseconds it is expected to wait
+* Description: the runway time of the aircraft ahead of it, emergencies only
+*              for an emergency, plus the time each aircraft on the runway now
+*              still needs, spread over params.capacity slots as in
+*              offline_bound(). Added to that are a switch if the aircraft, or
+*              the other side waiting ahead of it, needs the runway turned
+*              around, and the breaks the controller takes before its turn.
+*              Caller must hold the runway lock.
+ */
+static int64_t holding_predict(const aircraft_info *ai)
+{
+  const runway *rw = ai->runway;
+  int type = ai->aircraft_type;
+  int64_t now = sim_now();
+  int ahead = rw->emergency_waiting;
+  int64_t work = rw->waiting_ms[EMERGENCY];
+  int64_t wait;
+
+  if (type != EMERGENCY) {
+    ahead = ahead + rw->commercial_waiting + rw->cargo_waiting;
+    work = work + rw->waiting_ms[COMMERCIAL] + rw->waiting_ms[CARGO];
+  }
+  for (int i = 0; i < params.capacity; i++) {
+    if (rw->finish_ns[i] > now) {
+      work = work + (rw->finish_ns[i] - now) / NSEC_PER_MSEC;
+    }
+  }
+  wait = work / params.capacity;
+  if (type != EMERGENCY
+      && (runway_direction(rw) != (type == COMMERCIAL ? NORTH : SOUTH)
+          || (type == COMMERCIAL ? rw->cargo_waiting : rw->commercial_waiting) > 0)) {
+    wait = wait + params.switch_time;
+  }
+  return wait + (int64_t)((rw->aircraft_since_break + ahead) / params.controller_limit) * params.break_time;
+}
+
+/* 
+* Function: holding_admit
+* Parameters: ai - aircraft that has to wait for the runway it was assigned
+* Returns: int - 1 if it may wait, 0 if it has been diverted
+* Description: the admission control of -H. A diverted aircraft is logged,
+*              counted and taken off its runway's load, and its state is
+*              AC_DIVERTED; the caller hands its record back. Without -H every
+*              aircraft may wait. Caller must hold the runway lock.
+ */
+static int holding_admit(aircraft_info *ai)
+{
+  runway *rw = ai->runway;
+  int stack = rw->commercial_waiting + rw->cargo_waiting;
+  int64_t wait = -1;
+  int reason = -1;
+
+  if (holding_depth < 0) {
+    return 1;
+  }
+  if (ai->aircraft_type != EMERGENCY) {
+    if (holding_depth > 0 && stack >= holding_depth) {
+      reason = HOLD_FULL;
+    } else if ((wait = holding_predict(ai)) > (int64_t)ai->fuel_reserve * MSEC_PER_SEC) {
+      reason = HOLD_FUEL;
+    }
+  }
+  if (reason >= 0) {
+    rw->stats.diverted[reason] = rw->stats.diverted[reason] + 1;
+    __atomic_fetch_sub(&rw->load, 1, __ATOMIC_RELAXED);
+    ai->state = AC_DIVERTED;
+    log_emit(LOG_DIVERTED, rw->id, ai->aircraft_type, ai->aircraft_id, ai->fuel_reserve,
+             reason == HOLD_FULL ? -1 : (int)wait);
+    return 0;
+  }
+  rw->stats.held = rw->stats.held + 1;
+  if (ai->aircraft_type != EMERGENCY && stack + 1 > rw->stats.held_peak) {
+    rw->stats.held_peak = stack + 1;
+  }
+  return 1;
+}
+
+/*** Trace input ***/
+
+/* The input file is mapped into memory and read one aircraft at a time as the
+ * simulation needs it, so nothing is parsed ahead of time. Pages that have been
+ * read are dropped again every TRACE_WINDOW bytes, which keeps the resident size
+ * bounded however long the trace is. Two formats are accepted:
+ *
+ *   text    one "aircraft_type arrival_delay runway_time" line per aircraft,
+ *           the two times in seconds with up to three decimals ("12.25"),
+ *           '#' comment lines and blank lines are skipped
+ *   binary  a TRACE_HEADER_SIZE byte header ("RWYT", version, aircraft count)
+ *           followed by one little-endian 64-bit word per aircraft: 2 bits of
+ *           type, then 31 bits each of arrival delay and runway time in
+ *           milliseconds. Version 1 traces, 32-bit words with 15-bit fields in
+ *           whole seconds, are still read.
+ *
+ * Either way the times are handed out in milliseconds.
+ * `runway -c out.rwy trace.txt` converts a text trace to the binary format.
+ */
+
+#define TRACE_MAGIC       "RWYT"
+#define TRACE_VERSION     2
+#define TRACE_HEADER_SIZE 16
+#define TRACE_FIELD_MAX   0x7fffffff         /* Largest delay or runway time in milliseconds */
+#define TRACE_V1_MAX      32767              /* ... in seconds, in a version 1 trace */
+#define TRACE_WINDOW      (1 << 20)          /* Bytes read between dropping consumed pages */
+
+static struct
+{
+  const unsigned char *data;  // the mapped file, NULL if it is empty
+  size_t size;
+  size_t pos;                 // offset of the next unread byte
+  size_t dropped;             // consumed bytes already handed back to the kernel
+  int binary;                 // file is in the binary format: its version, 0 if text
+  int next_id;                // id given to the next aircraft read
+  int64_t read_time;          // milliseconds from the first arrival to that of the last aircraft read
+  size_t ahead_pos;           // -d plan: offset after the last aircraft counted in upcoming
+  int64_t ahead_time;         // arrival time of that aircraft, like read_time
+  int ahead_id;               // id of the aircraft after that one
+  int last_type;              // type of the last aircraft read, -1 before the first
+  int upcoming[3];            // aircraft per type from the last read to PLAN_HORIZON after it
+} trace;
+
+/* reads a little-endian unsigned integer of the given width */
+static uint64_t trace_load(const unsigned char *p, int bytes)
+{
+  uint64_t value = 0;
+
+  for (int i = bytes - 1; i >= 0; i--) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+static void trace_store(unsigned char *p, uint64_t value, int bytes)
+{
+  for (int i = 0; i < bytes; i++) {
+    p[i] = (unsigned char)(value >> (8 * i));
+  }
+}
+
+/* parses a decimal integer like sscanf("%d"); returns 0 if there is none before end */
+static int trace_int(const unsigned char **p, const unsigned char *end, int *value)
+{
+  const unsigned char *s = *p;
+  long v = 0;
+  int negative = 0;
+
+  while (s < end && (*s == ' ' || *s == '\t')) {
+    s = s + 1;
+  }
+  if (s < end && (*s == '-' || *s == '+')) {
+    negative = (*s == '-');
+    s = s + 1;
+  }
+  if (s == end || *s < '0' || *s > '9') {
+    return 0;
+  }
+  while (s < end && *s >= '0' && *s <= '9' && v <= 0x7fffffffL) {
+    v = v * 10 + (*s - '0');
+    s = s + 1;
+  }
+  *value = (int)(negative ? -v : v);
+  *p = s;
+  return 1;
+}
+
+/* parses a time in seconds with up to three decimals into milliseconds, like trace_int() */
+static int trace_ms(const unsigned char **p, const unsigned char *end, int *value)
+{
+  const unsigned char *s = *p;
+  int64_t ms;
+  int whole;
+
+  while (s < end && (*s == ' ' || *s == '\t')) {
+    s = s + 1;
+  }
+  if (s < end && *s == '-') {
+    return 0;
+  }
+  if (!trace_int(&s, end, &whole) || whole > TRACE_FIELD_MAX / MSEC_PER_SEC) {
+    return 0;
+  }
+  ms = (int64_t)whole * MSEC_PER_SEC;
+  if (s < end && *s == '.') {
+    s = s + 1;
+    for (int scale = MSEC_PER_SEC / 10; s < end && *s >= '0' && *s <= '9'; scale = scale / 10) {
+      ms = ms + (*s - '0') * scale;
+      s = s + 1;
+    }
+  }
+  *value = (int)ms;
+  *p = s;
+  return 1;
+}
+
+/* gives pages that have been read back to the kernel once a window has passed */
+static void trace_drop_consumed(void)
+{
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t upto = trace.pos / page * page;
+
+  if (upto - trace.dropped >= TRACE_WINDOW) {
+    madvise((void *)(trace.data + trace.dropped), upto - trace.dropped, MADV_DONTNEED);
+    trace.dropped = upto;
+  }
+}
+
+/* 
+* Function:   trace_decode
+* Parameters: pos - offset to decode at, advanced past the aircraft
+*             type, arrival_time, runway_time - filled in with the aircraft,
+*             the times in milliseconds
+* Returns: int - 1 if an aircraft was decoded, 0 at the end of the trace
+* Description: decodes the aircraft at *pos in either format, skipping
+*              comments, blank lines and lines that do not parse. Aircraft of
+*              a type other than COMMERCIAL, CARGO or EMERGENCY are skipped
+*              too, in either format. Digits beyond the millisecond are dropped.
+ */
+static int trace_decode(size_t *pos, int *type, int *arrival_time, int *runway_time)
+{
+  while (trace.binary == 1) {
+    uint32_t word;
+
+    if (trace.size - *pos < 4) {
+      return 0;
+    }
+    word = (uint32_t)trace_load(trace.data + *pos, 4);
+    *pos = *pos + 4;
+    *type = (int)(word & 3);
+    *arrival_time = (int)((word >> 2) & TRACE_V1_MAX) * MSEC_PER_SEC;
+    *runway_time = (int)(word >> 17) * MSEC_PER_SEC;
+    if (*type <= EMERGENCY) {
+      return 1;
+    }
+  }
+  while (trace.binary) {
+    uint64_t word;
+
+    if (trace.size - *pos < 8) {
+      return 0;
+    }
+    word = trace_load(trace.data + *pos, 8);
+    *pos = *pos + 8;
+    *type = (int)(word & 3);
+    *arrival_time = (int)((word >> 2) & TRACE_FIELD_MAX);
+    *runway_time = (int)(word >> 33);
+    if (*type <= EMERGENCY) {
+      return 1;
+    }
+  }
+
+  while (*pos < trace.size) {
+    const unsigned char *line = trace.data + *pos;
+    const unsigned char *end = memchr(line, '\n', trace.size - *pos);
+    const unsigned char *p = line;
+
+    end = (end == NULL) ? trace.data + trace.size : end;
+    *pos = (size_t)(end - trace.data) + (end < trace.data + trace.size);
+
+    /* Skip comment lines and empty lines */
+    if (line == end || line[0] == '#' || line[0] == '\r') {
+      continue;
+    }
+    if (trace_int(&p, end, type) && *type >= COMMERCIAL && *type <= EMERGENCY
+        && trace_ms(&p, end, arrival_time) && trace_ms(&p, end, runway_time)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* reads the next aircraft of the trace; returns 0 at the end */
+static int trace_read(int *type, int *arrival_time, int *runway_time)
+{
+  if (!trace_decode(&trace.pos, type, arrival_time, runway_time)) {
+    return 0;
+  }
+  trace_drop_consumed();
+  return 1;
+}
+
+/* 
+* Function:   trace_forecast
+* Parameters: type - type of the aircraft just read
+* Returns: void
+* Description: keeps trace.upcoming counting the aircraft that arrive within
+*              PLAN_HORIZON seconds of the one just read, that one included.
+*              A second cursor runs ahead of the reading one, so every aircraft
+*              is decoded about twice however long the horizon is. The counts
+*              are read by the controllers without the global lock.
+ */
+static void trace_forecast(int type)
+{
+  int next_type, arrival_time, runway_time;
+
+  if (trace.last_type >= 0) {
+    __atomic_fetch_sub(&trace.upcoming[trace.last_type], 1, __ATOMIC_RELAXED);
+  }
+  trace.last_type = (type >= COMMERCIAL && type <= EMERGENCY) ? type : -1;
+  if (trace.ahead_id <= trace.next_id) {
+    // beyond the horizon of the previous aircraft: start counting again here
+    trace.ahead_pos = trace.pos;
+    trace.ahead_time = trace.read_time;
+    trace.ahead_id = trace.next_id + 1;
+    if (trace.last_type >= 0) {
+      __atomic_fetch_add(&trace.upcoming[type], 1, __ATOMIC_RELAXED);
+    }
+  }
+  for (;;) {
+    size_t pos = trace.ahead_pos;
+
+    if (!trace_decode(&pos, &next_type, &arrival_time, &runway_time)
+        || trace.ahead_time + arrival_time > trace.read_time + PLAN_HORIZON * MSEC_PER_SEC) {
+      break;
+    }
+    trace.ahead_pos = pos;
+    trace.ahead_time = trace.ahead_time + arrival_time;
+    trace.ahead_id = trace.ahead_id + 1;
+    if (next_type >= COMMERCIAL && next_type <= EMERGENCY) {
+      __atomic_fetch_add(&trace.upcoming[next_type], 1, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/* aircraft of a type arriving within PLAN_HORIZON seconds, 0 unless -d plan */
+static int trace_upcoming(int type)
+{
+  return __atomic_load_n(&trace.upcoming[type], __ATOMIC_RELAXED);
+}
+
+/* 
+* Function:   trace_next
+* Parameters: None
+* Returns: aircraft_info* - the next aircraft of the trace, NULL after the last one
+* Description: reads the next aircraft from the input file into a fresh arena
+*              record and assigns its id and a random fuel reserve. Caller must
+*              hold lock.
+ */
+static aircraft_info *trace_next(void)
+{
+  int type, arrival_time, runway_time;
+  aircraft_info *ai;
+
+  if (!trace_read(&type, &arrival_time, &runway_time)) {
+    return NULL;
+  }
+
+  ai = aircraft_alloc();
+  ai->aircraft_type = type;
+  ai->arrival_time = arrival_time;
+  ai->runway_time = runway_time;
+  /* Assign random fuel reserve between FUEL_MIN and FUEL_MAX */
+  ai->fuel_reserve = FUEL_MIN + (rand() % (FUEL_MAX - FUEL_MIN + 1));
+  ai->aircraft_id = trace.next_id;
+  trace.read_time = trace.read_time + arrival_time;
+  if (plan_forecast()) {
+    trace_forecast(type);
+  }
+  trace.next_id = trace.next_id + 1;
+  return ai;
+}
+
+/* 
+* Function:   trace_open
+* Parameters: filename - text or binary trace
+* Returns: int - number of aircraft in the trace
+* Description: maps the trace into memory. A binary trace stores its aircraft
+*              count in the header; a text trace is counted with one pass over
+*              the mapping, which is then rewound.
+ */
+static int trace_open(const char *filename)
+{
+  struct stat st;
+  int fd;
+  int count = 0;
+  int type, arrival_time, runway_time;
+
+  memset(&trace, 0, sizeof(trace));
+  trace.last_type = -1;
+
+  if ((fd = open(filename, O_RDONLY)) < 0 || fstat(fd, &st) < 0) 
+  {
+    printf("Cannot open input file %s for reading.\n", filename);
+    exit(1);
+  }
+
+  trace.size = (size_t)st.st_size;
+  if (trace.size > 0) {
+    void *map = mmap(NULL, trace.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      printf("Cannot map input file %s: %s\n", filename, strerror(errno));
+      exit(1);
+    }
+    trace.data = map;
+    madvise(map, trace.size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (trace.size >= TRACE_HEADER_SIZE && memcmp(trace.data, TRACE_MAGIC, 4) == 0) {
+    uint64_t version = trace_load(trace.data + 4, 4);
+
+    if (version < 1 || version > TRACE_VERSION) {
+      printf("Input file %s has an unsupported trace version.\n", filename);
+      exit(1);
+    }
+    trace.binary = (int)version;
+    trace.pos = TRACE_HEADER_SIZE;
+    return (int)trace_load(trace.data + 8, 8);
+  }
+
+  while (trace_read(&type, &arrival_time, &runway_time)) {
+    count = count + 1;
+  }
+  trace.pos = 0;
+  trace.dropped = 0;
+  return count;
+}
+
+/* unmaps the trace once the simulation is over */
+static void trace_close(void)
+{
+  if (trace.data != NULL) {
+    munmap((void *)trace.data, trace.size);
+  }
+  memset(&trace, 0, sizeof(trace));
+}
+
+/* 
+* Function:   trace_convert
+* Parameters: filename - where to write the binary trace
+*             count - number of aircraft returned by trace_open()
+* Returns: int - 0 on success, 1 on error
+* Description: writes the open trace out in the binary format.
+ */
+static int trace_convert(const char *filename, int count)
+{
+  unsigned char buf[TRACE_HEADER_SIZE];
+  int type, arrival_time, runway_time;
+  int written = 0;
+  FILE *out;
+
+  if ((out = fopen(filename, "wb")) == NULL) {
+    printf("Cannot open output file %s for writing.\n", filename);
+    return 1;
+  }
+
+  memcpy(buf, TRACE_MAGIC, 4);
+  trace_store(buf + 4, TRACE_VERSION, 4);
+  trace_store(buf + 8, (uint64_t)count, 8);
+  fwrite(buf, 1, TRACE_HEADER_SIZE, out);
+
+  while (trace_read(&type, &arrival_time, &runway_time)) {
+    if (type < COMMERCIAL || type > EMERGENCY || arrival_time < 0 || runway_time < 0) {
+      printf("Aircraft %d cannot be stored in a binary trace (type %d, delay %d ms, runway time %d ms).\n",
+             written, type, arrival_time, runway_time);
+      fclose(out);
+      remove(filename);
+      return 1;
+    }
+    trace_store(buf, (uint64_t)type | (uint64_t)arrival_time << 2 | (uint64_t)runway_time << 33, 8);
+    fwrite(buf, 1, 8, out);
+    written = written + 1;
+  }
+
+  if (fclose(out) != 0) {
+    printf("Cannot write output file %s: %s\n", filename, strerror(errno));
+    return 1;
+  }
+  printf("Wrote %d aircraft to %s\n", written, filename);
+  return 0;
+}
+
+/* 
+* Function:   initialize
+* Parameters: filename - string containing input file path, NULL under -A
+* Returns: int - number of aircraft in the file
+* Description: initializes all simulation variables and synchroniztion primitives.
+*             Maps the input file and counts the aircraft in it; the aircraft
+*             themselves are read one at a time by trace_next() as they arrive.
+*             Under -A the clients bring the aircraft and there is no file.
+ */
+static int initialize(char *filename) 
+{
+  pthread_condattr_t attr;
+
+  // the controllers sleep until the next deadline timer on the monotonic clock
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+  memset(runways, 0, sizeof(runways));
+  for (int i = 0; i < num_runways; i++) {
+    runway *rw = &runways[i];
+
+    rw->id = i;
+    rw->last_aircraft_type = -1;
+    wheel_init(&rw->wheel);
+    runway_since_break(rw, 0);
+
+    /* Initialize your synchronization variables (and 
+     * other variables you might use) here
+     */
+    lock_init(&rw->lock);
+    pthread_cond_init(&rw->cond_check, NULL);
+    pthread_cond_init(&rw->cond_controller, &attr);
+  }
+  pthread_condattr_destroy(&attr);
+
+  /* seed random number generator for fuel reserves */
+  srand(sim_seed);
+
+  /* Open the data file and count the aircraft in it */
+  memset(&arena, 0, sizeof(arena));
+  return filename != NULL ? trace_open(filename) : 0;
+}
+
+/* Code executed by controller to simulate taking a break 
+ * You do not need to add anything here.  
+ */
+__attribute__((unused)) static void take_break(runway *rw) 
+{
+  log_emit(LOG_BREAK, rw->id, -1, -1, rw->aircraft_since_break < params.controller_limit, 0);
+  sleep_ms(params.break_time);
+  assert( on_runway(rw) == 0 );
+  runway_since_break(rw, 0);
+}
+
+/* Code executed to switch runway direction
+ * You do not need to add anything here.
+ */
+__attribute__((unused)) static void switch_direction(runway *rw)
+{
+  log_emit(LOG_SWITCHING, rw->id, -1, -1, runway_direction(rw),
+           runway_direction(rw) == NORTH ? SOUTH : NORTH);
+  
+  assert( on_runway(rw) == 0 );  // Runway must be empty to switch
+  
+  // aircraft that arrive meanwhile join the queue, as in the event engine
+  lock_release(&rw->lock);
+  sleep_ms(params.switch_time);
+  lock_acquire(&rw->lock);
+  
+  __atomic_fetch_xor(&rw->state, STATE_SOUTH, __ATOMIC_ACQ_REL);
+  rw->consecutive_direction = 0;
+  rw->direction_since = sim_now();
+  
+  log_emit(LOG_SWITCHED, rw->id, -1, -1, runway_direction(rw), 0);
+}
+
+/* 
+* Function: controller_poke
+* Parameters: rw - runway whose controller may have something to do
+* Returns: void
+* Description: wakes the controller only when it has something to do: the runway
+*              it is draining for a switch or break is now empty, a switch has
+*              become justified, a break is due or can be taken early, or the
+*              simulation is over. Caller must hold the runway lock.
+ */
+static void controller_poke(runway *rw)
+{
+  uint64_t snapshot = runway_state(rw);
+  int drained = (snapshot & (STATE_SWITCHING | STATE_BREAK)) && state_count(snapshot, -1) == 0;
+  int idle = !(snapshot & (STATE_SWITCHING | STATE_BREAK));
+
+  if (simulation_done || drained
+      || (idle && (policy.should_switch(rw) || policy.should_break(rw, 0)))) {
+    pthread_cond_signal(&rw->cond_controller);
+  }
+}
+
+/* 
+* Function: runway_changed
+* Parameters: rw - runway whose state changed
+* Returns: void
+* Description: wakes whoever can make progress after the runway state changed.
+*              With targeted wakeups it admits every waiting aircraft the rules now
+*              allow and signals exactly those aircraft. With broadcast wakeups
+*              every waiter is woken to re-check. Either way the controller is
+*              only woken if the change gives it something to do. Caller must
+*              hold the runway lock.
+ */
+static void runway_changed(runway *rw)
+{
+  aircraft_info *ai;
+
+  if (wakeup_mode == WAKE_BROADCAST) {
+    pthread_cond_broadcast(&rw->cond_check);
+  } else {
+    while ((ai = runway_admit_next(rw)) != NULL) {
+      pthread_cond_signal(&ai->cond);
+    }
+  }
+  controller_poke(rw);
+}
+
+/* 
+* Function: wait_for_runway
+* Parameters: ai - aircraft requesting the runway
+* Returns: void
+* Description: blocks the calling aircraft thread until it is on the runway.
+*              With targeted wakeups the aircraft joins its type's wait queue and
+*              sleeps on its own condition variable until runway_changed() admits
+*              it. With broadcast wakeups it sleeps on cond_check and re-checks
+*              the rules after every broadcast. Caller must hold the lock of
+*              the runway the aircraft was assigned to.
+ */
+static void wait_for_runway(aircraft_info *ai)
+{
+  runway *rw = ai->runway;
+
+  aircraft_arrive(ai);
+
+  if (wakeup_mode == WAKE_BROADCAST) {
+    // counted as waiting until on the runway, so no fast-path aircraft takes the slot
+    waiting_add(ai, 1);
+    while (!runway_admissible(rw, ai->aircraft_type) && !runway_fits(rw, ai)) {
+      controller_poke(rw);  // we may be the opposite traffic the controller waits for
+      lock_wait(&rw->lock, &rw->cond_check, NULL);  // resume when conditions change
+      rw->stats.wakeups = rw->stats.wakeups + 1;
+      if (!runway_admissible(rw, ai->aircraft_type) && !runway_fits(rw, ai)) {
+        rw->stats.spurious = rw->stats.spurious + 1;
+      }
+    }
+    ai->state = AC_ON_RUNWAY;
+    runway_take(rw, ai->aircraft_type);
+    runway_occupy(ai);
+    waiting_add(ai, -1);
+    runway_changed(rw);
+    return;
+  }
+
+  pthread_cond_init(&ai->cond, NULL);
+  queue_push(ai);
+  runway_changed(rw);  // admits us right away if the rules and queue order allow
+  while (ai->state != AC_ON_RUNWAY) {
+    lock_wait(&rw->lock, &ai->cond, NULL);
+    rw->stats.wakeups = rw->stats.wakeups + 1;
+    if (ai->state != AC_ON_RUNWAY) {
+      rw->stats.spurious = rw->stats.spurious + 1;
+    }
+  }
+  pthread_cond_destroy(&ai->cond);
+}
+
+/* 
+* Function: runway_enter
+* Parameters: ai - aircraft requesting the runway it was assigned to
+* Returns: void
+* Description: the fast path. If nobody is waiting for the runway and the rules
+*              let the aircraft on, a single compare-and-swap on the runway state
+*              admits it, and the lock is only taken to count it. Otherwise it
+*              goes down the wait path in wait_for_runway(), unless -H diverts
+*              it: then it returns in state AC_DIVERTED.
+ */
+static void runway_enter(aircraft_info *ai)
+{
+  runway *rw = ai->runway;
+  uint64_t s = runway_state(rw);
+  int fast;
+
+  do {
+    fast = !(s & (STATE_QUEUED | STATE_BREAK_NEAR)) && state_admits(s, ai->aircraft_type) && !replay_pending(rw);
+  } while (fast && !__atomic_compare_exchange_n(&rw->state, &s, s + state_one(ai->aircraft_type), 1,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+  lock_acquire(&rw->lock);
+  if (fast) {
+    aircraft_arrive(ai);
+    ai->state = AC_ON_RUNWAY;
+    runway_occupy(ai);
+    rw->stats.fast = rw->stats.fast + 1;
+    controller_poke(rw);  // a limit may have been reached
+  } else if (holding_admit(ai)) {
+    wait_for_runway(ai);
+  }
+  lock_release(&rw->lock);
+}
+
+/* 
+* Function: controller_wait
+* Parameters: rw - the controller's runway
+* Returns: void
+* Description: sleeps on the runway's cond_controller, but no longer than until
+*              the next deadline timer is due, then fires whatever timers have
+*              expired. Each controller thread is the only one that turns its
+*              runway's timer wheel in the threaded simulation. Caller must hold
+*              the runway lock.
+ */
+static void controller_wait(runway *rw)
+{
+  int64_t next = wheel_next_ns(&rw->wheel);
+
+  if (next < 0) {
+    lock_wait(&rw->lock, &rw->cond_controller, NULL);
+  } else {
+    struct timespec ts;
+    int64_t due = sim_epoch + next;
+
+    ts.tv_sec  = due / NSEC_PER_SEC;
+    ts.tv_nsec = due % NSEC_PER_SEC;
+    lock_wait(&rw->lock, &rw->cond_controller, &ts);
+  }
+  wheel_advance(&rw->wheel, sim_now());
+}
+
+/* 
+* Function: controller_thread
+* Parameters: arg - the runway this controller is in charge of
+* Returns: void* - NULL on exit
+* Description - main thread function for the air traffic controller of a runway. The function 
+*               monitors runway state, handles direction switches when consecutive limit 
+*               is reached, or opposite trafic is waiting, manages controller breaks as well.
+*               Between decisions it sleeps on cond_controller until controller_poke()
+*               reports a change it cares about, so it reacts immediately and uses no
+*               CPU while idle. It also wakes for deadline timers, so a critical
+*               aircraft waiting for the other direction gets the runway turned
+*               around. Returns once main() sets simulation_done.
+ */
+void *controller_thread(void *arg) 
+{
+  runway *rw = (runway *)arg;
+
+  log_emit(LOG_CONTROLLER_START, rw->id, -1, -1, 0, 0);
+
+  lock_acquire(&rw->lock);
+
+  /* Loop while waiting for aircraft to arrive. */
+  while (!simulation_done) 
+  {
+    /*
+    * the controller will check whether too many aircrafts have used the runway in
+    * the same direction or of the same type consecutively. This is to prevent the runway 
+    * going in one direction or aircraft type, maintaing fairness.
+    */
+    if (policy.should_switch(rw)) {
+      // the policy may have a break that is coming anyway taken while the runway turns
+      int with_break = policy.should_break(rw, 1);
+
+      runway_close(rw, PAUSE_SWITCH); // indicate runway direction switch
+      if (with_break) {
+        runway_close(rw, PAUSE_BREAK);
+      }
+      if (pack_mode == PACK_FILL || replay_pending(rw)) {
+        runway_changed(rw); // free slots can still be filled while the runway drains
+      }
+      while (on_runway(rw) > 0 || replay_holds_drain(rw)) {
+        controller_wait(rw); // wait till all aircrafts currently on are done
+      }
+      decision_made(rw, DECIDE_DRAINED, -1);
+      stats_pause_drained(&rw->stats, PAUSE_SWITCH);
+      if (with_break) {
+        stats_pause_drained(&rw->stats, PAUSE_BREAK);
+        log_emit(LOG_BREAK, rw->id, -1, -1, rw->aircraft_since_break < params.controller_limit, 0);
+      }
+      switch_direction(rw);
+      rw->consecutive_direction = 0; // reset counters for tracking
+      rw->consecutive_type_count = 0; // the other type gets its turn now
+      runway_flag(rw, STATE_SWITCHING, 0);
+      stats_pause_end(&rw->stats, PAUSE_SWITCH);
+
+      if (with_break) {
+        // the rest of the break, if it is longer than the switch
+        lock_release(&rw->lock);
+        if (params.break_time > params.switch_time) {
+          sleep_ms(params.break_time - params.switch_time);
+        }
+        lock_acquire(&rw->lock);
+        if (rw->aircraft_since_break < params.controller_limit) {
+          rw->stats.pause[PAUSE_BREAK].early = rw->stats.pause[PAUSE_BREAK].early + 1;
+        }
+        runway_flag(rw, STATE_BREAK, 0);
+        runway_since_break(rw, 0);
+        stats_pause_end(&rw->stats, PAUSE_BREAK);
+        log_emit(LOG_BREAK_OVER, rw->id, -1, -1, 0, 0);
+      }
+    }
+    
+    /*
+    * the controller must take a break to simulate fatigue. During this, no new 
+    * aircrafts can use the runway until the controller returns. The policy may
+    * also send it ahead of time while the runway is idle.
+    */
+    if (policy.should_break(rw, 0)) {
+      int early = rw->aircraft_since_break < params.controller_limit;
+
+      runway_close(rw, PAUSE_BREAK);
+      if (pack_mode == PACK_FILL || replay_pending(rw)) {
+        runway_changed(rw);
+      }
+      // ensure all operations finish before controller takes a break
+      while (on_runway(rw) > 0 || replay_holds_drain(rw)) {
+        controller_wait(rw);
+      }
+      decision_made(rw, DECIDE_DRAINED, -1);
+      stats_pause_drained(&rw->stats, PAUSE_BREAK);
+
+      lock_release(&rw->lock); // allow other mutex threads to proceed while on break
+      take_break(rw); // rest break
+      lock_acquire(&rw->lock); // resume control after break
+      runway_flag(rw, STATE_BREAK, 0);
+      runway_since_break(rw, 0);
+      rw->stats.pause[PAUSE_BREAK].early = rw->stats.pause[PAUSE_BREAK].early + early;
+      stats_pause_end(&rw->stats, PAUSE_BREAK);
+      log_emit(LOG_BREAK_OVER, rw->id, -1, -1, 0, 0);
+    }
+
+    // wake up the waiting threads that can go now that conditions have changed
+    runway_changed(rw);
+
+    // sleep until an aircraft leaves, a limit is reached or opposite traffic arrives
+    if (!simulation_done && !policy.should_switch(rw) && !policy.should_break(rw, 0)) {
+      controller_wait(rw);
+    }
+  }
+
+  lock_release(&rw->lock);
+  log_detach();
+  pthread_exit(NULL);
+}
+
+
+/* 
+* Function: commercial_enter
+* Parameters: aircraft_info - pointer to aircraft structure
+* Returns: void
+* Description: handles the sync for a commercial airplane requesting runway access. Blocks until
+*              the aircraft can safetly use the runway according to all constraints
+ */
+void commercial_enter(aircraft_info *arg) 
+{
+  // Suppress the compiler warning
+  (void)arg;
+
+  /* TODO */
+  /* Request permission to use the runway. You might also want to add      */
+  /* synchronization for the simulation variables below.                   */
+  /* Consider: runway capacity, direction (commercial prefer NORTH),       */
+  /* controller breaks, fuel levels, emergency priorities, and fairness.   */
+  /*  YOUR CODE HERE.                                                      */ 
+  runway_assign(arg);
+
+  /*
+  * a commercial aircraft must wait if runway is at max capacity, current direction is south,
+  * runway direction is being switched, and if the controller is on break
+  */
+  runway_enter(arg);
+}
+
+/* 
+* Function: cargo_enter
+* Parameters: aircraft_info - pointer to aircraft structure
+* Returns: void
+* Description: handles the sync for a cargo airplane requesting runway access. Blocks until
+*              the aircraft can safetly use the runway according to all constraints
+ */
+void cargo_enter(aircraft_info *ai) 
+{
+  (void)ai;
+
+  /* TODO */
+  /* Request permission to use the runway. You might also want to add      */
+  /* synchronization for the simulation variables below.                   */
+  /* Consider: runway capacity, direction (cargo prefer SOUTH),            */
+  /* controller breaks, fuel levels, emergency priorities, and fairness.   */
+  /*  YOUR CODE HERE.                                                      */ 
+
+  runway_assign(ai);
+
+  // same thing as commercial_enter(), but for cargo aircrafts
+  runway_enter(ai);
+}
+
+/* 
+* Function: emergency_enter
+* Parameters: aircraft_info - pointer to aircraft structure
+* Returns: void
+* Description: handles the sync for a emergency airplane requesting runway access. Blocks until
+*              the aircraft can safetly use the runway according to all constraints
+ */
+void emergency_enter(aircraft_info *ai) 
+{
+  (void)ai;
+
+  /* TODO */
+  /* Request permission to use the runway. You might also want to add      */
+  /* synchronization for the simulation variables below.                   */
+  /* Emergency aircraft have priority and must be admitted within 30s,     */
+  /* but still respect runway capacity and controller breaks.              */
+  /* Emergency aircraft can use either direction.                          */
+  /*  YOUR CODE HERE.                                                      */ 
+
+
+  runway_assign(ai);
+  runway_enter(ai);
+}
+
+/* Code executed by an aircraft to simulate the time spent on the runway
+ * You do not need to add anything here.  
+ */
+static void use_runway(int t) 
+{
+  sleep_ms(t);
+}
+
+
+/* 
+* Function: commercial_leave
+* Parameters: rw - runway the aircraft is leaving
+* Returns: void
+* Description: handles synchronization when a commercial aircraft departs the runway. will
+*              decrement aircraft counter and signals waiting threads that runway space may
+*              be available.
+ */
+static void commercial_leave(runway *rw) 
+{
+  /* 
+   *  TODO
+   *  YOUR CODE HERE.
+   */
+  lock_acquire(&rw->lock); // ensure no race conditions occur
+
+  runway_release(rw, COMMERCIAL); // the slot is free from here on
+  runway_vacate(rw);
+
+  runway_changed(rw); // admit whoever can enter now
+  lock_release(&rw->lock); // unlock to allow other threads
+}
+
+/* 
+* Function: cargo_leave
+* Parameters: rw - runway the aircraft is leaving
+* Returns: void
+* Description: handles synchronization when a cargo aircraft departs the runway. will
+*              decrement aircraft counter and signals waiting threads that runway space may
+*              be available.
+ */
+static void cargo_leave(runway *rw) 
+{
+  /* 
+   * TODO
+   * YOUR CODE HERE. 
+   */
+  lock_acquire(&rw->lock); // prevent race conditions
+
+  runway_release(rw, CARGO); // the slot is free from here on
+  runway_vacate(rw);
+
+  runway_changed(rw); // admit whoever can enter now
+  lock_release(&rw->lock); // unlock for other threads
+}
+
+/* 
+* Function: emergency_leave
+* Parameters: rw - runway the aircraft is leaving
+* Returns: void
+* Description: handles synchronization when a emergency aircraft departs the runway. will
+*              decrement aircraft counter and signals waiting threads that runway space may
+*              be available.
+ */
+static void emergency_leave(runway *rw) 
+{
+  /* 
+   * TODO
+   * YOUR CODE HERE. 
+   */
+  lock_acquire(&rw->lock); // prevent race conditions
+
+  runway_release(rw, EMERGENCY); // the slot is free from here on
+  runway_vacate(rw);
+
+  runway_changed(rw); // admit whoever can enter now
+  lock_release(&rw->lock); // unlock for threads
+}
+
+/* hands the record of a finished aircraft thread back to the arena */
+static void aircraft_release(aircraft_info *ai)
+{
+  lock_acquire(&lock);
+  aircraft_free(ai);
+  if (arena.in_flight == 0) {
+    pthread_cond_signal(&cond_released); // main() may be waiting for the last one
+  }
+  lock_release(&lock);
+  log_detach();
+}
+
+/* Main code for commercial aircraft threads.  
+ * You do not need to change anything here, but you can add
+ * debug statements to help you during development/debugging.
+ */
+void* commercial_aircraft(void *ai_ptr) 
+{
+  aircraft_info *ai = (aircraft_info*)ai_ptr;
+  runway *rw;
+  uint64_t snapshot;
+  
+  /* Record arrival time for fuel tracking */
+
+  /* Request runway access */
+  commercial_enter(ai);
+  rw = ai->runway;
+  if (ai->state == AC_DIVERTED) {
+    aircraft_release(ai);
+    pthread_exit(NULL);
+  }
+
+  snapshot = runway_state(rw);
+  log_emit(LOG_ON_RUNWAY, rw->id, COMMERCIAL, ai->aircraft_id, ai->fuel_reserve,
+           state_direction(snapshot));
+
+  state_check(snapshot, COMMERCIAL);
   
   /* Use runway  --- do not make changes to the 3 lines below*/
-  printf("Commercial aircraft %d begins runway operations for %d seconds\n", 
-         ai->aircraft_id, ai->runway_time);
+  log_emit(LOG_RUNWAY_BEGIN, rw->id, COMMERCIAL, ai->aircraft_id, ai->runway_time, 0);
+  use_runway(ai->runway_time);
+  log_emit(LOG_RUNWAY_END, rw->id, COMMERCIAL, ai->aircraft_id, 0, 0);
+
+  /* Leave runway */
+  commercial_leave(rw);  
+
+  log_emit(LOG_CLEARED, rw->id, COMMERCIAL, ai->aircraft_id, 0, 0);
+
+  state_check(runway_state(rw), -1);
+
+  aircraft_release(ai);
+  pthread_exit(NULL);
+}
+
+/* Main code for cargo aircraft threads.
+ * You do not need to change anything here, but you can add
+ * debug statements to help you during development/debugging.
+ */
+void* cargo_aircraft(void *ai_ptr) 
+{
+  aircraft_info *ai = (aircraft_info*)ai_ptr;
+  runway *rw;
+  uint64_t snapshot;
+  
+  /* Record arrival time for fuel tracking */
+
+  /* Request runway access */
+  cargo_enter(ai);
+  rw = ai->runway;
+  if (ai->state == AC_DIVERTED) {
+    aircraft_release(ai);
+    pthread_exit(NULL);
+  }
+
+  snapshot = runway_state(rw);
+  log_emit(LOG_ON_RUNWAY, rw->id, CARGO, ai->aircraft_id, ai->fuel_reserve,
+           state_direction(snapshot));
+
+  state_check(snapshot, CARGO);
+
+  log_emit(LOG_RUNWAY_BEGIN, rw->id, CARGO, ai->aircraft_id, ai->runway_time, 0);
+  use_runway(ai->runway_time);
+  log_emit(LOG_RUNWAY_END, rw->id, CARGO, ai->aircraft_id, 0, 0);
+
+  /* Leave runway */
+  cargo_leave(rw);        
+
+  log_emit(LOG_CLEARED, rw->id, CARGO, ai->aircraft_id, 0, 0);
+
+  state_check(runway_state(rw), -1);
+
+  aircraft_release(ai);
+  pthread_exit(NULL);
+}
+
+/* Main code for emergency aircraft threads.
+ * You do not need to change anything here, but you can add
+ * debug statements to help you during development/debugging.
+ */
+void* emergency_aircraft(void *ai_ptr) 
+{
+  aircraft_info *ai = (aircraft_info*)ai_ptr;
+  runway *rw;
+  uint64_t snapshot;
+  
+  /* Record arrival time for fuel and emergency timeout tracking */
+
+  /* Request runway access */
+  emergency_enter(ai);
+  rw = ai->runway;
+  if (ai->state == AC_DIVERTED) {
+    aircraft_release(ai);
+    pthread_exit(NULL);
+  }
+
+  snapshot = runway_state(rw);
+  log_emit(LOG_ON_RUNWAY, rw->id, EMERGENCY, ai->aircraft_id, ai->fuel_reserve,
+           state_direction(snapshot));
+
+  state_check(snapshot, EMERGENCY);
+
+  log_emit(LOG_RUNWAY_BEGIN, rw->id, EMERGENCY, ai->aircraft_id, ai->runway_time, 0);
   use_runway(ai->runway_time);
-  printf("Commercial aircraft %d completes runway operations and prepares to depart\n", 
-         ai->aircraft_id);
+  log_emit(LOG_RUNWAY_END, rw->id, EMERGENCY, ai->aircraft_id, 0, 0);
+
+  /* Leave runway */
+  emergency_leave(rw);        
+
+  log_emit(LOG_CLEARED, rw->id, EMERGENCY, ai->aircraft_id, 0, 0);
+
+  state_check(runway_state(rw), -1);
+
+  aircraft_release(ai);
+  pthread_exit(NULL);
+}
+
+/*** Discrete-event engine ***/
+
+/* The engine runs the same admission rules as the aircraft threads, but
+ * aircraft and the controller are state machines and every sleep() becomes an
+ * event in a queue. On the virtual clock the queue is drained by one thread as
+ * fast as its events can be processed. In pool mode a fixed set of workers
+ * processes each event when it falls due on the real clock, so waiting
+ * aircraft cost a queue entry instead of a blocked thread.
+ */
+
+#define EV_ARRIVAL     0   /* next aircraft in the trace arrives */
+#define EV_RUNWAY_DONE 1   /* an aircraft finishes its runway operations */
+#define EV_SWITCH_DONE 2   /* the runway direction switch has completed */
+#define EV_BREAK_DONE  3   /* the controller is back from the break */
+#define EV_WHEEL       4   /* the timer wheel has timers due */
+
+#define CTRL_IDLE         0 /* controller is handling aircraft normally */
+#define CTRL_SWITCH_DRAIN 1 /* waiting for the runway to empty before switching */
+#define CTRL_SWITCHING    2 /* direction switch in progress */
+#define CTRL_BREAK_DRAIN  3 /* waiting for the runway to empty before a break */
+#define CTRL_BREAK        4 /* controller is on break */
+
+typedef struct
+{
+  int64_t time;       // simulated time the event fires, in nanoseconds
+  uint64_t seq;       // insertion order, breaks ties between equal times
+  int kind;           // EV_*
+  runway *rw;         // runway the event happens on, NULL for arrivals and EV_WHEEL
+  aircraft_info *ai;  // aircraft the event belongs to, NULL for controller events
+} sim_event;
+
+/* all fields are protected by lock once workers are running */
+static struct
+{
+  int64_t now;               // current simulated time in nanoseconds
+  uint64_t seq;              // sequence number for the next event
+  sim_event *heap;           // pending events, binary min-heap on (time, seq)
+  int heap_len;
+  int heap_cap;
+  int real_time;             // events fire on the monotonic clock instead of instantly
+  int64_t epoch;             // monotonic time at which the simulation started
+  int timekeeper;            // a worker is sleeping until the next event is due
+  pthread_cond_t tick;       // wakes the timekeeper when an earlier event arrives
+  pthread_cond_t idle;       // wakes a worker to take over as timekeeper
+  int64_t wheel_event;       // time of the pending EV_WHEEL, -1 if none
+} engine;
+
+/* current simulation time in nanoseconds since the start of the run */
+static int64_t sim_now(void)
+{
+  if (sim_mode == MODE_THREADS) {
+    return monotonic_ns() - sim_epoch;
+  }
+  return engine.now;
+}
+
+static int event_before(const sim_event *a, const sim_event *b)
+{
+  return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+/* 
+* Function: engine_schedule
+* Parameters: delay - nanoseconds from now until the event fires
+*             kind - EV_* event type
+*             rw - runway the event happens on, or NULL
+*             ai - aircraft the event belongs to, or NULL
+* Returns: void
+* Description: inserts an event into the engine's event heap.
+ */
+static void engine_schedule(int64_t delay, int kind, runway *rw, aircraft_info *ai)
+{
+  sim_event ev;
+  int i;
+
+  if (engine.heap_len == engine.heap_cap) {
+    engine.heap_cap = engine.heap_cap ? engine.heap_cap * 2 : 64;
+    engine.heap = realloc(engine.heap, engine.heap_cap * sizeof(sim_event));
+    if (engine.heap == NULL) {
+      printf("runway: out of memory for the event queue\n");
+      exit(1);
+    }
+  }
+
+  ev.time = engine.now + delay;
+  ev.seq  = engine.seq++;
+  ev.kind = kind;
+  ev.rw   = rw;
+  ev.ai   = ai;
+
+  // sift up
+  i = engine.heap_len++;
+  while (i > 0 && event_before(&ev, &engine.heap[(i - 1) / 2])) {
+    engine.heap[i] = engine.heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  engine.heap[i] = ev;
+
+  // an earlier deadline than the one the timekeeper is sleeping towards
+  if (i == 0 && engine.timekeeper) {
+    pthread_cond_signal(&engine.tick);
+  }
+}
+
+/* removes the earliest event from the heap into *ev. Returns 0 if none is left. */
+static int engine_next_event(sim_event *ev)
+{
+  sim_event last;
+  int i = 0;
+
+  if (engine.heap_len == 0) {
+    return 0;
+  }
+  *ev  = engine.heap[0];
+  last = engine.heap[--engine.heap_len];
+
+  // sift the last element down from the root
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= engine.heap_len) {
+      break;
+    }
+    if (child + 1 < engine.heap_len && event_before(&engine.heap[child + 1], &engine.heap[child])) {
+      child = child + 1;
+    }
+    if (!event_before(&engine.heap[child], &last)) {
+      break;
+    }
+    engine.heap[i] = engine.heap[child];
+    i = child;
+  }
+  engine.heap[i] = last;
+  return 1;
+}
+
+static void server_answer(aircraft_info *ai, uint32_t state);
+
+/* 
+* Function: engine_admit_waiting
+* Parameters: rw - runway that may have room
+* Returns: void
+* Description: admits waiting aircraft for as long as the runway rules allow,
+*              earliest arrival first, and schedules the end of their runway
+*              operations; under -A it grants the runway to their clients,
+*              who say when they are done.
+ */
+static void engine_admit_waiting(runway *rw)
+{
+  aircraft_info *ai;
+
+  while ((ai = runway_admit_next(rw)) != NULL) {
+    uint64_t snapshot = runway_state(rw);
+
+    state_check(snapshot, ai->aircraft_type);
+    log_emit(LOG_ON_RUNWAY, rw->id, ai->aircraft_type, ai->aircraft_id, ai->fuel_reserve,
+             state_direction(snapshot));
+    log_emit(LOG_RUNWAY_BEGIN, rw->id, ai->aircraft_type, ai->aircraft_id, ai->runway_time, 0);
+    if (sim_mode == MODE_SERVER) {
+      server_answer(ai, SLOT_GRANTED);
+    } else {
+      engine_schedule(ai->runway_time * NSEC_PER_MSEC, EV_RUNWAY_DONE, rw, ai);
+    }
+  }
+}
+
+/* starts a pending switch or break once the runway has drained */
+static void engine_controller_start(runway *rw)
+{
+  if (on_runway(rw) > 0 || replay_holds_drain(rw)) {
+    return;
+  }
+  if (rw->controller == CTRL_SWITCH_DRAIN || rw->controller == CTRL_BREAK_DRAIN) {
+    decision_made(rw, DECIDE_DRAINED, -1);
+  }
+  if (rw->controller == CTRL_SWITCH_DRAIN) {
+    if (runway_state(rw) & STATE_BREAK) {
+      log_emit(LOG_BREAK, rw->id, -1, -1, rw->aircraft_since_break < params.controller_limit, 0);
+      stats_pause_drained(&rw->stats, PAUSE_BREAK);
+    }
+    log_emit(LOG_SWITCHING, rw->id, -1, -1, runway_direction(rw),
+             runway_direction(rw) == NORTH ? SOUTH : NORTH);
+    stats_pause_drained(&rw->stats, PAUSE_SWITCH);
+    rw->controller = CTRL_SWITCHING;
+    engine_schedule(params.switch_time * NSEC_PER_MSEC, EV_SWITCH_DONE, rw, NULL);
+  } else if (rw->controller == CTRL_BREAK_DRAIN) {
+    log_emit(LOG_BREAK, rw->id, -1, -1, rw->aircraft_since_break < params.controller_limit, 0);
+    stats_pause_drained(&rw->stats, PAUSE_BREAK);
+    rw->controller = CTRL_BREAK;
+    engine_schedule(params.break_time * NSEC_PER_MSEC, EV_BREAK_DONE, rw, NULL);
+  }
+}
+
+/* 
+* Function: engine_controller_step
+* Parameters: rw - runway whose controller decides
+* Returns: void
+* Description: the controller's decisions, evaluated after every event instead of
+*              on a polling interval. Mirrors controller_thread(): switch direction
+*              first if justified, with the break alongside if it may come early,
+*              otherwise take a break once the policy's should_break() says so.
+ */
+static void engine_controller_step(runway *rw)
+{
+  if (rw->controller == CTRL_IDLE) {
+    if (policy.should_switch(rw)) {
+      int with_break = policy.should_break(rw, 1);
+
+      runway_close(rw, PAUSE_SWITCH);
+      rw->controller = CTRL_SWITCH_DRAIN;
+      if (with_break) {
+        runway_close(rw, PAUSE_BREAK);
+      }
+    } else if (policy.should_break(rw, 0)) {
+      runway_close(rw, PAUSE_BREAK);
+      rw->controller = CTRL_BREAK_DRAIN;
+    }
+    if (pack_mode == PACK_FILL || replay_pending(rw)) {
+      engine_admit_waiting(rw);
+    }
+  }
+  engine_controller_start(rw);
+}
+
+/* 
+* Function: engine_arrive
+* Parameters: ai - aircraft that has just arrived
+* Returns: int - 1 if it waits for its runway, 0 if it has been diverted
+* Description: assigns the aircraft a runway and queues it there; the next
+*              engine_admit_waiting() lets it on if the rules allow. The caller
+*              hands back the record of a diverted aircraft.
+ */
+static int engine_arrive(aircraft_info *ai)
+{
+  runway *rw;
+
+  assert(ai->state == AC_ARRIVING);
+  rw = runway_assign(ai);
+  if (((runway_state(rw) & STATE_QUEUED) || !runway_admissible(rw, ai->aircraft_type))
+      && !holding_admit(ai)) {
+    return 0;
+  }
+  aircraft_arrive(ai);
+  queue_push(ai);
+  return 1;
+}
+
+/* gives the runway slot of an aircraft that is done with it back, and its record */
+static void engine_depart(aircraft_info *ai)
+{
+  runway *rw = ai->runway;
+
+  assert(ai->state == AC_ON_RUNWAY);
+  ai->state = AC_CLEARED;
+  log_emit(LOG_RUNWAY_END, rw->id, ai->aircraft_type, ai->aircraft_id, 0, 0);
+  runway_release(rw, ai->aircraft_type);
+  runway_vacate(rw);
+  log_emit(LOG_CLEARED, rw->id, ai->aircraft_type, ai->aircraft_id, 0, 0);
+  state_check(runway_state(rw), -1);
+  aircraft_free(ai);
+}
+
+/* processes a single event at the current simulated time */
+static void engine_handle(sim_event *ev)
+{
+  aircraft_info *ai = ev->ai;
+  runway *rw = ev->rw;
+
+  switch (ev->kind) {
+  case EV_ARRIVAL:
+    if (!engine_arrive(ai)) {
+      aircraft_free(ai);
+    }
+    ai = trace_next();
+    if (ai != NULL) {
+      engine_schedule(ai->arrival_time * NSEC_PER_MSEC, EV_ARRIVAL, NULL, ai);
+    }
+    break;
+
+  case EV_RUNWAY_DONE:
+    engine_depart(ai);
+    break;
+
+  case EV_SWITCH_DONE:
+    __atomic_fetch_xor(&rw->state, STATE_SOUTH, __ATOMIC_ACQ_REL);
+    rw->consecutive_direction = 0;
+    rw->consecutive_type_count = 0;
+    rw->direction_since = engine.now;
+    runway_flag(rw, STATE_SWITCHING, 0);
+    log_emit(LOG_SWITCHED, rw->id, -1, -1, runway_direction(rw), 0);
+    stats_pause_end(&rw->stats, PAUSE_SWITCH);
+
+    // a break taken with the switch lasts as long as it is longer
+    rw->controller = CTRL_IDLE;
+    if (runway_state(rw) & STATE_BREAK) {
+      rw->controller = CTRL_BREAK;
+      engine_schedule(params.break_time > params.switch_time
+                      ? (int64_t)(params.break_time - params.switch_time) * NSEC_PER_MSEC : 0,
+                      EV_BREAK_DONE, rw, NULL);
+      break;
+    }
+
+    // like controller_thread(), check for a due break before admitting anyone
+    if (replay_pending(rw) ? policy.should_break(rw, 0)
+                           : rw->aircraft_since_break >= params.controller_limit) {
+      runway_close(rw, PAUSE_BREAK);
+      rw->controller = CTRL_BREAK_DRAIN;
+    }
+    break;
+
+  case EV_BREAK_DONE:
+    if (rw->aircraft_since_break < params.controller_limit) {
+      rw->stats.pause[PAUSE_BREAK].early = rw->stats.pause[PAUSE_BREAK].early + 1;
+    }
+    runway_flag(rw, STATE_BREAK, 0);
+    runway_since_break(rw, 0);
+    stats_pause_end(&rw->stats, PAUSE_BREAK);
+    log_emit(LOG_BREAK_OVER, rw->id, -1, -1, 0, 0);
+    rw->controller = CTRL_IDLE;
+    break;
+
+  case EV_WHEEL:
+    // the timers themselves fired in engine_worker(); drop superseded events
+    if (ev->time == engine.wheel_event) {
+      engine.wheel_event = -1;
+    }
+    break;
+  }
+}
+
+/* makes sure an EV_WHEEL is pending for the next time any runway's timer wheel has work */
+static void engine_wheel_sync(void)
+{
+  int64_t next = -1;
+
+  for (int i = 0; i < num_runways; i++) {
+    int64_t due = wheel_next_ns(&runways[i].wheel);
+
+    if (due >= 0 && (next < 0 || due < next)) {
+      next = due;
+    }
+  }
+  if (next >= 0 && (engine.wheel_event < 0 || next < engine.wheel_event)) {
+    engine.wheel_event = next;
+    engine_schedule(next - engine.now, EV_WHEEL, NULL, NULL);
+  }
+}
+
+/* nonzero for an EV_WHEEL that an earlier one has superseded, or whose timers
+ * have all been cancelled since it was scheduled. Handling it would only move
+ * the clock, so it is dropped unhandled. */
+static int engine_wheel_stale(const sim_event *ev)
+{
+  if (ev->kind != EV_WHEEL) {
+    return 0;
+  }
+  if (ev->time != engine.wheel_event) {
+    return 1;
+  }
+  for (int i = 0; i < num_runways; i++) {
+    if (runways[i].wheel.armed > 0) {
+      return 0;
+    }
+  }
+  engine.wheel_event = -1;
+  return 1;
+}
+
+/* 
+* Function: engine_worker
+* Parameters: arg - unused, for pthread compatibility
+* Returns: void* - NULL once the event queue is empty
+* Description: pops and processes events until none are left. On the virtual
+*              clock the next event is always due immediately. In real time one
+*              idle worker sleeps until the earliest event is due while the
+*              others wait to take over, so a wakeup is never broadcast to the
+*              whole pool. Events are handled one at a time under the global
+*              lock, which covers every runway; after each one every runway
+*              admits whoever it can and its controller decides.
+ */
+static void *engine_worker(void *arg)
+{
+  (void)arg;
+
+  lock_acquire(&lock);
+  while (engine.heap_len > 0) {
+    sim_event ev;
+
+    if (engine_wheel_stale(&engine.heap[0])) {
+      engine_next_event(&ev);
+      continue;
+    }
+    if (engine.real_time) {
+      int64_t due = engine.epoch + engine.heap[0].time;
+
+      if (engine.timekeeper) {
+        lock_wait(&lock, &engine.idle, NULL);
+        continue;
+      }
+      if (monotonic_ns() < due) {
+        struct timespec ts;
+
+        ts.tv_sec  = due / NSEC_PER_SEC;
+        ts.tv_nsec = due % NSEC_PER_SEC;
+        engine.timekeeper = 1;
+        lock_wait(&lock, &engine.tick, &ts);
+        engine.timekeeper = 0;
+        pthread_cond_signal(&engine.idle);
+        continue;
+      }
+    }
+
+    engine_next_event(&ev);
+    engine.now = ev.time;
+    for (int i = 0; i < num_runways; i++) {
+      wheel_advance(&runways[i].wheel, engine.now);
+    }
+    engine_handle(&ev);
+    for (int i = 0; i < num_runways; i++) {
+      engine_admit_waiting(&runways[i]);
+      engine_controller_step(&runways[i]);
+    }
+    engine_wheel_sync();
+
+    // every event is a critical section of its own, so the lock statistics
+    // show what handling one costs
+    lock_release(&lock);
+    lock_acquire(&lock);
+  }
+
+  // queue drained: release the workers still waiting for their turn
+  pthread_cond_broadcast(&engine.idle);
+  lock_release(&lock);
+  log_detach();
+  return NULL;
+}
+
+/* 
+* Function: engine_run
+* Parameters: mode - MODE_VIRTUAL or MODE_POOL
+*             workers - number of pool workers (ignored on the virtual clock)
+* Returns: int - number of aircraft left waiting forever, 0 on success
+* Description: runs the whole simulation as events. Produces the same log as the
+*              threaded simulation, with ties between threads resolved in arrival
+*              order. On the virtual clock it finishes as soon as the events are
+*              processed; in pool mode it takes as long as the threaded run but
+*              uses only the given number of threads. Each arrival reads the
+*              next aircraft from the trace, so only aircraft that have arrived
+*              but not yet cleared the runway hold a record.
+ */
+static int engine_run(int mode, int workers)
+{
+  pthread_t *tid;
+  aircraft_info *first;
+  pthread_condattr_t attr;
+  int type;
+  int result;
+  int stranded = 0;
+
+  memset(&engine, 0, sizeof(engine));
+  engine.real_time = (mode == MODE_POOL);
+  engine.wheel_event = -1;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&engine.tick, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_cond_init(&engine.idle, NULL);
+
+  for (int i = 0; i < num_runways; i++) {
+    log_emit(LOG_CONTROLLER_START, i, -1, -1, 0, 0);
+  }
+
+  engine.epoch = monotonic_ns();
+  first = trace_next();
+  engine_schedule(first->arrival_time * NSEC_PER_MSEC, EV_ARRIVAL, NULL, first);
+
+  if (!engine.real_time) {
+    engine_worker(NULL);
+  } else {
+    tid = malloc(workers * sizeof(pthread_t));
+    if (tid == NULL) {
+      printf("runway: out of memory for %d workers\n", workers);
+      exit(1);
+    }
+    for (int i = 0; i < workers; i++) {
+      result = pthread_create(&tid[i], NULL, engine_worker, NULL);
+      if (result) {
+        printf("runway: pthread_create failed for worker %d: %s\n", i, strerror(result));
+        exit(1);
+      }
+    }
+    for (int i = 0; i < workers; i++) {
+      pthread_join(tid[i], NULL);
+    }
+    free(tid);
+  }
+
+  for (int i = 0; i < num_runways; i++) {
+    for (type = COMMERCIAL; type <= EMERGENCY; type++) {
+      stranded = stranded + queue_length(&runways[i].queue[type]);
+    }
+  }
+  free(engine.heap);
+  pthread_cond_destroy(&engine.tick);
+  pthread_cond_destroy(&engine.idle);
+
+  return stranded;
+}
+
+/* adds one runway's figures to a running total */
+static void stats_merge(runway_stats *into, const runway_stats *from)
+{
+  for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+    hist_merge(&into->wait[type], &from->wait[type]);
+    into->admitted[type] = into->admitted[type] + from->admitted[type];
+    into->deadline_misses[type] = into->deadline_misses[type] + from->deadline_misses[type];
+  }
+  for (int n = 0; n <= params.capacity; n++) {
+    into->occupancy_ns[n] = into->occupancy_ns[n] + from->occupancy_ns[n];
+  }
+  for (int kind = PAUSE_SWITCH; kind <= PAUSE_BREAK; kind++) {
+    into->pause[kind].count = into->pause[kind].count + from->pause[kind].count;
+    into->pause[kind].drain_ns = into->pause[kind].drain_ns + from->pause[kind].drain_ns;
+    into->pause[kind].pause_ns = into->pause[kind].pause_ns + from->pause[kind].pause_ns;
+    into->pause[kind].early = into->pause[kind].early + from->pause[kind].early;
+    into->pause[kind].overlap_ns = into->pause[kind].overlap_ns + from->pause[kind].overlap_ns;
+  }
+  into->break_lost_ns = into->break_lost_ns + from->break_lost_ns;
+  into->slot_wasted_ns = into->slot_wasted_ns + from->slot_wasted_ns;
+  into->wakeups = into->wakeups + from->wakeups;
+  into->spurious = into->spurious + from->spurious;
+  into->fast = into->fast + from->fast;
+  into->held = into->held + from->held;
+  into->diverted[HOLD_FULL] = into->diverted[HOLD_FULL] + from->diverted[HOLD_FULL];
+  into->diverted[HOLD_FUEL] = into->diverted[HOLD_FUEL] + from->diverted[HOLD_FUEL];
+  if (from->held_peak > into->held_peak) {
+    into->held_peak = from->held_peak;
+  }
+  if (from->last_cleared > into->last_cleared) {
+    into->last_cleared = from->last_cleared;
+  }
+}
+
+/* the figures of all runways added up; call once the simulation is over */
+static const runway_stats *stats_total(void)
+{
+  static runway_stats total;
+
+  memset(&total, 0, sizeof(total));
+  for (int i = 0; i < num_runways; i++) {
+    stats_merge(&total, &runways[i].stats);
+  }
+  return &total;
+}
+
+/* prints how many aircraft got the runway only after their deadline had passed */
+static void print_deadline_report(void)
+{
+  const int *misses = stats_total()->deadline_misses;
+  const int *admitted = stats_total()->admitted;
+
+  printf("Deadline misses: %d of %d aircraft (commercial %d, cargo %d, emergency %d)\n",
+         misses[COMMERCIAL] + misses[CARGO] + misses[EMERGENCY],
+         admitted[COMMERCIAL] + admitted[CARGO] + admitted[EMERGENCY],
+         misses[COMMERCIAL], misses[CARGO], misses[EMERGENCY]);
+}
+
+/* 
+* Function: print_stats
+* Parameters: json - file to write the statistics to as JSON as well, or NULL
+* Returns: int - 0 on success, 1 if the JSON file could not be written
+* Description: prints the wait time percentiles per aircraft type, how busy the
+*              runways were, how much time switches and breaks took, how the
+*              locks were used and what the run cost in wall-clock time. With
+*              several runways the busy figures are given per runway and the
+*              rest is added up over all of them.
+ */
+static int print_stats(const char *json)
+{
+  static const char *names[4] = { "commercial", "cargo", "emergency", "all" };
+  static const char *pause_names[2] = { "switches", "breaks" };
+  static histogram all;
+  const runway_stats *total;
+  const pause_stats *brk;
+  const histogram *h[4];
+  int64_t elapsed = sim_now();
+  int64_t wall = monotonic_ns() - sim_epoch;
+  double per_hour;
+  double switches_per_hour;
+  double slots;
+  int64_t slot_used = 0;
+  double mean_hold;
+  sim_lock locks;
+  FILE *out;
+
+  memset(&locks, 0, sizeof(locks));
+  lock_merge(&locks, &lock);
+  for (int i = 0; i < num_runways; i++) {
+    stats_occupancy(&runways[i].stats, 0, elapsed);
+    lock_merge(&locks, &runways[i].lock);
+  }
+  total = stats_total();
+  brk = &total->pause[PAUSE_BREAK];
+  for (int n = 1; n <= params.capacity; n++) {
+    slot_used = slot_used + n * total->occupancy_ns[n];
+  }
+  mean_hold = locks.sampled ? (double)locks.hold_ns / locks.sampled : 0.0;
+
+  memset(&all, 0, sizeof(all));
+  for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+    hist_merge(&all, &total->wait[type]);
+    h[type] = &total->wait[type];
+  }
+  h[3] = &all;
+  per_hour = elapsed > 0 ? all.total * 3600.0 / seconds(elapsed) : 0.0;
+  switches_per_hour = elapsed > 0 ? total->pause[PAUSE_SWITCH].count * 3600.0 / seconds(elapsed) : 0.0;
+
+  printf("Wait for the runway (s)   count       p50       p99      p999       max\n");
+  for (int i = 0; i < 4; i++) {
+    printf("  %-20s %10llu %9.3f %9.3f %9.3f %9.3f\n", i < 3 ? aircraft_label(i) : "All aircraft",
+           (unsigned long long)h[i]->total, seconds(hist_percentile(h[i], 0.5)),
+           seconds(hist_percentile(h[i], 0.99)), seconds(hist_percentile(h[i], 0.999)),
+           seconds(h[i]->max));
+  }
+  for (int i = 0; i < num_runways; i++) {
+    const runway_stats *s = &runways[i].stats;
+    int64_t in_use = 0;
+    char name[24] = "Runway";
+
+    for (int n = 1; n <= params.capacity; n++) {
+      in_use = in_use + n * s->occupancy_ns[n];
+    }
+    if (num_runways > 1) {
+      snprintf(name, sizeof(name), "Runway %d", i + 1);
+    }
+    printf("%s busy %.1f%% of %.3f s, %.2f of %d slots in use on average", name,
+           elapsed > 0 ? 100.0 * (elapsed - s->occupancy_ns[0]) / elapsed : 0.0,
+           seconds(elapsed), elapsed > 0 ? (double)in_use / elapsed : 0.0, params.capacity);
+    if (num_runways > 1) {
+      printf(", %d aircraft assigned", runways[i].assigned);
+    }
+    printf("\n");
+  }
+  slots = (double)elapsed * params.capacity * num_runways;
+  printf("Runway slots: %.3f slot-seconds used (%.1f%%), "
+         "%.3f left empty while aircraft waited (%.1f%%)\n",
+         seconds(slot_used), slots > 0 ? 100.0 * slot_used / slots : 0.0,
+         seconds(total->slot_wasted_ns), slots > 0 ? 100.0 * total->slot_wasted_ns / slots : 0.0);
+  printf("Direction switches: %d, %.1f per hour, %.3f s switching after %.3f s draining the runway\n",
+         total->pause[PAUSE_SWITCH].count, switches_per_hour,
+         seconds(total->pause[PAUSE_SWITCH].pause_ns), seconds(total->pause[PAUSE_SWITCH].drain_ns));
+  printf("Controller breaks: %d (%d early), %.3f s on break after %.3f s draining the runway\n",
+         brk->count, brk->early, seconds(brk->pause_ns), seconds(brk->drain_ns));
+  printf("Runway time lost to breaks: %.3f s with aircraft waiting, %.3f s during switches\n",
+         seconds(total->break_lost_ns), seconds(brk->overlap_ns));
+  if (holding_depth >= 0) {
+    printf("Holding: %d held, at most %d at once; %d diverted (%d stack full, %d short of fuel), "
+           "%d admitted\n", total->held, total->held_peak,
+           total->diverted[HOLD_FULL] + total->diverted[HOLD_FUEL], total->diverted[HOLD_FULL],
+           total->diverted[HOLD_FUEL], (int)all.total);
+  }
+  printf("Throughput: %.1f aircraft per simulated hour\n", per_hour);
+  printf("Lock: %llu acquisitions, %.2f%% contended (%.3f ms waiting), hold %.0f ns mean, %.3f ms max\n",
+         (unsigned long long)locks.acquired,
+         locks.acquired ? 100.0 * locks.contended / locks.acquired : 0.0,
+         locks.wait_ns / 1e6, mean_hold, locks.hold_max / 1e6);
+  printf("Wall clock: %.3f s, %.0f ns per aircraft\n", seconds(wall),
+         all.total ? (double)wall / all.total : 0.0);
+
+  if (json == NULL) {
+    return 0;
+  }
+  if ((out = fopen(json, "w")) == NULL) {
+    printf("Cannot open statistics file %s for writing.\n", json);
+    return 1;
+  }
+  fprintf(out, "{\n  \"elapsed_s\": %.9f,\n  \"wait_s\": {\n", seconds(elapsed));
+  for (int i = 0; i < 4; i++) {
+    fprintf(out, "    \"%s\": {\"count\": %llu, \"mean\": %.9f, \"p50\": %.9f, \"p99\": %.9f, "
+            "\"p999\": %.9f, \"max\": %.9f}%s\n", names[i], (unsigned long long)h[i]->total,
+            h[i]->total ? seconds(h[i]->sum) / h[i]->total : 0.0,
+            seconds(hist_percentile(h[i], 0.5)), seconds(hist_percentile(h[i], 0.99)),
+            seconds(hist_percentile(h[i], 0.999)), seconds(h[i]->max), i < 3 ? "," : "");
+  }
+  fprintf(out, "  },\n  \"runway\": {\"count\": %d, \"capacity\": %d, \"occupancy_s\": [",
+          num_runways, params.capacity);
+  for (int n = 0; n <= params.capacity; n++) {
+    fprintf(out, "%s%.9f", n ? ", " : "", seconds(total->occupancy_ns[n]));
+  }
+  fprintf(out, "], \"slot_used_s\": %.9f, \"slot_wasted_s\": %.9f, \"assigned\": [",
+          seconds(slot_used), seconds(total->slot_wasted_ns));
+  for (int i = 0; i < num_runways; i++) {
+    fprintf(out, "%s%d", i ? ", " : "", runways[i].assigned);
+  }
+  fprintf(out, "]},\n");
+  for (int kind = PAUSE_SWITCH; kind <= PAUSE_BREAK; kind++) {
+    fprintf(out, "  \"%s\": {\"count\": %d, \"drain_s\": %.9f, \"pause_s\": %.9f", pause_names[kind],
+            total->pause[kind].count, seconds(total->pause[kind].drain_ns),
+            seconds(total->pause[kind].pause_ns));
+    if (kind == PAUSE_BREAK) {
+      fprintf(out, ", \"early\": %d, \"overlap_s\": %.9f, \"lost_s\": %.9f", brk->early,
+              seconds(brk->overlap_ns), seconds(total->break_lost_ns));
+    }
+    fprintf(out, "},\n");
+  }
+  if (holding_depth >= 0) {
+    fprintf(out, "  \"holding\": {\"depth\": %d, \"held\": %d, \"peak\": %d, \"diverted_full\": %d, "
+            "\"diverted_fuel\": %d},\n", holding_depth, total->held, total->held_peak,
+            total->diverted[HOLD_FULL], total->diverted[HOLD_FUEL]);
+  }
+  fprintf(out, "  \"throughput_per_hour\": %.3f,\n  \"switches_per_hour\": %.3f,\n", per_hour,
+          switches_per_hour);
+  fprintf(out, "  \"lock\": {\"acquired\": %llu, \"contended\": %llu, \"wait_s\": %.9f, "
+          "\"hold_mean_ns\": %.1f, \"hold_max_s\": %.9f},\n",
+          (unsigned long long)locks.acquired, (unsigned long long)locks.contended,
+          seconds(locks.wait_ns), mean_hold, seconds(locks.hold_max));
+  fprintf(out, "  \"wall_s\": %.9f,\n  \"wall_ns_per_aircraft\": %.1f,\n", seconds(wall),
+          all.total ? (double)wall / all.total : 0.0);
+  fprintf(out, "  \"deadline_misses\": {\"commercial\": %d, \"cargo\": %d, \"emergency\": %d}\n}\n",
+          total->deadline_misses[COMMERCIAL], total->deadline_misses[CARGO],
+          total->deadline_misses[EMERGENCY]);
+  fclose(out);
+  return 0;
+}
+
+/*** Live metrics ***/
+
+/* With -M a publisher thread copies the runway state, the queue depths and the
+ * running statistics into a shared memory page every METRICS_PERIOD_MS, for
+ * runway-top to display. The counters and histograms are plain fields that
+ * the aircraft and controllers keep updating, so each runway is copied under
+ * the lock that protects it in this mode: its own with aircraft threads, the
+ * global one in the event engine. The lock is held only for that copy. The
+ * layout is in metrics.h.
+ */
+
+static struct
+{
+  const char *name;        // shared memory object, NULL without -M
+  metrics_page *page;
+  pthread_t tid;
+  int stop;
+} metrics;
+
+/* the lock that protects a runway's counters in this run's mode */
+static sim_lock *metrics_lock(runway *rw)
+{
+  return sim_mode == MODE_THREADS ? &rw->lock : &lock;
+}
+
+/* 
+* Function: metrics_publish
+* Parameters: done - nonzero for the last snapshot, once the simulation is over
+* Returns: void
+* Description: writes one snapshot into the page under its seqlock. Only the
+*              publisher thread, and main() once it has joined it, writes.
+ */
+static void metrics_publish(int done)
+{
+  static histogram all;
+  metrics_page *m = metrics.page;
+  int64_t now = 0;
+  uint64_t admitted = 0;
+  int switches = 0;
+  int breaks = 0;
+
+  memset(&all, 0, sizeof(all));
+  __atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  m->done = done;
+  m->runways = num_runways;
+  m->capacity = params.capacity;
+  for (int i = 0; i < num_runways; i++) {
+    runway *rw = &runways[i];
+    metrics_runway *r = &m->runway[i];
+    uint64_t state;
+
+    lock_acquire(metrics_lock(rw));
+    now = sim_now();  // the engine's clock is under the same lock
+    state = runway_state(rw);
+    for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+      hist_merge(&all, &rw->stats.wait[type]);
+      r->on_runway[type] = state_count(state, type);
+      admitted = admitted + rw->stats.admitted[type];
+    }
+    r->on_runway[3] = state_count(state, -1);
+    r->waiting[COMMERCIAL] = rw->commercial_waiting;
+    r->waiting[CARGO] = rw->cargo_waiting;
+    r->waiting[EMERGENCY] = rw->emergency_waiting;
+    r->direction = state_direction(state);
+    r->switching = (state & STATE_SWITCHING) != 0;
+    r->on_break = (state & STATE_BREAK) != 0;
+    r->since_break = rw->aircraft_since_break;
+    r->assigned = __atomic_load_n(&rw->assigned, __ATOMIC_RELAXED);
+    switches = switches + rw->stats.pause[PAUSE_SWITCH].count;
+    breaks = breaks + rw->stats.pause[PAUSE_BREAK].count;
+    lock_release(metrics_lock(rw));
+  }
+  m->sim_ns = now;
+  m->wall_ns = monotonic_ns() - sim_epoch;
+  m->admitted = admitted;
+  m->per_hour = now > 0 ? admitted * 3600.0 / seconds(now) : 0.0;
+  m->wait_ns[0] = hist_percentile(&all, 0.5);
+  m->wait_ns[1] = hist_percentile(&all, 0.99);
+  m->wait_ns[2] = hist_percentile(&all, 0.999);
+  m->wait_ns[3] = all.max;
+  m->switches = switches;
+  m->breaks = breaks;
+
+  __atomic_store_n(&m->seq, m->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* publishes a snapshot every METRICS_PERIOD_MS until metrics_stop() */
+static void *metrics_thread(void *arg)
+{
+  struct timespec period = { 0, METRICS_PERIOD_MS * 1000000L };
+
+  (void)arg;
+  while (!__atomic_load_n(&metrics.stop, __ATOMIC_ACQUIRE)) {
+    metrics_publish(0);
+    nanosleep(&period, NULL);
+  }
+  return NULL;
+}
+
+/* 
+* Function: metrics_start
+* Returns: int - 0 on success, 1 if the shared memory object could not be set up
+* Description: creates the -M shared memory object, sized and mapped for one
+*              metrics_page, and starts the publisher. Does nothing without -M.
+ */
+static int metrics_start(void)
+{
+  int fd;
+  int result;
+
+  if (metrics.name == NULL) {
+    return 0;
+  }
+  fd = shm_open(metrics.name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate(fd, sizeof(metrics_page)) != 0) {
+    printf("runway: cannot create shared memory %s: %s\n", metrics.name, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return 1;
+  }
+  metrics.page = mmap(NULL, sizeof(metrics_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (metrics.page == MAP_FAILED) {
+    printf("runway: cannot map shared memory %s: %s\n", metrics.name, strerror(errno));
+    shm_unlink(metrics.name);
+    return 1;
+  }
+  metrics.page->pid = (int32_t)getpid();
+  metrics_publish(0);
+  __atomic_store_n(&metrics.page->magic, METRICS_MAGIC, __ATOMIC_RELEASE);
+
+  result = pthread_create(&metrics.tid, NULL, metrics_thread, NULL);
+  if (result) {
+    printf("runway: pthread_create failed for the metrics publisher: %s\n", strerror(result));
+    exit(1);
+  }
+  return 0;
+}
+
+/* publishes the final snapshot and removes the shared memory object; a
+ * runway-top that has it open still sees that snapshot */
+static void metrics_stop(void)
+{
+  if (metrics.page == NULL) {
+    return;
+  }
+  __atomic_store_n(&metrics.stop, 1, __ATOMIC_RELEASE);
+  pthread_join(metrics.tid, NULL);
+  metrics_publish(1);
+  munmap(metrics.page, sizeof(metrics_page));
+  metrics.page = NULL;
+  shm_unlink(metrics.name);
+}
+
+/*** Admission server ***/
+
+/* With -A NAME there is no trace. The controllers and runway state serve
+ * aircraft flown by clients in other processes, through the shared memory
+ * object NAME; its layout and protocol are in admission.h. One thread runs the
+ * event engine in real time. Between events it takes requests off the ring:
+ * an enter is an arrival, a leave is the end of that aircraft's runway
+ * operations, and an admission is answered in the client's slot instead of
+ * scheduling EV_RUNWAY_DONE. Switches, breaks and deadline timers stay engine
+ * events, as in pool mode. While requests keep coming a round trip is a few
+ * cache line transfers; an idle side costs one futex wakeup.
+ */
+
+#define SERVER_SPIN_NS 50000     /* Server polls the ring this long after a request before sleeping */
+#define SERVER_IDLE_MS 100       /* Longest the server sleeps before looking for a stop signal */
+#define SERVER_REAP_MS 1000      /* How often the server looks for aircraft of clients that have died */
+
+static struct
+{
+  const char *name;                          // shared memory object, NULL without -A
+  admission_page *page;
+  aircraft_info *aircraft[ADMISSION_SLOTS];  // the aircraft of each slot, once it has entered
+  int next_id;                               // number of the next aircraft in the log
+  int shutdown;                              // a client has asked the server to stop
+  uint64_t requests;                         // requests taken off the ring
+  uint64_t rejected;                         // ... for a slot or in a state that made no sense
+  uint64_t sleeps;                           // times the server slept on the doorbell
+  uint64_t wakeups;                          // clients woken from their slot's futex
+  int reclaimed;                             // aircraft taken back from their clients
+} server;
+
+static volatile sig_atomic_t server_stop = 0;   /* SIGINT or SIGTERM: stop once the aircraft are gone */
+static volatile sig_atomic_t server_force = 0;  /* ... a second time: take them back and stop */
+
+static void server_signal(int sig)
+{
+  (void)sig;
+  if (server_stop) {
+    server_force = 1;
+  }
+  server_stop = 1;
+}
+
+/* sleeps on a futex in shared memory for as long as it holds expected, until
+ * woken or until the absolute monotonic time until, if given */
+static void futex_wait(uint32_t *word, uint32_t expected, const struct timespec *until)
+{
+  syscall(SYS_futex, word, FUTEX_WAIT_BITSET, expected, until, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static void futex_wake(uint32_t *word)
+{
+  syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+/* 
+* Function: server_publish
+* Parameters: index - the client's slot
+*             state - SLOT_GRANTED or SLOT_DIVERTED
+*             ai - the slot's aircraft, NULL if the server never let it arrive
+* Returns: void
+* Description: fills in the slot and publishes the answer, waking the client
+*              only if it has gone to sleep on the slot. Without an aircraft
+*              the runway, direction and id are -1 and the wait 0, so nothing
+*              of the slot's previous user shows through. Caller must hold lock.
+ */
+static void server_publish(int index, uint32_t state, const aircraft_info *ai)
+{
+  admission_slot *slot = &server.page->slot[index];
+
+  slot->runway = ai != NULL ? ai->runway->id : -1;
+  slot->direction = ai != NULL ? runway_direction(ai->runway) : -1;
+  slot->aircraft_id = ai != NULL ? ai->aircraft_id : -1;
+  slot->wait_ns = ai != NULL && state == SLOT_GRANTED ? sim_now() - ai->arrival_ns : 0;
+  if (__atomic_exchange_n(&slot->state, state, __ATOMIC_RELEASE) & SLOT_SLEEPING) {
+    futex_wake(&slot->state);
+    server.wakeups = server.wakeups + 1;
+  }
+}
+
+/* answers the client of an aircraft with SLOT_GRANTED or SLOT_DIVERTED */
+static void server_answer(aircraft_info *ai, uint32_t state)
+{
+  server_publish(ai->slot, state, ai);
+}
+
+/* takes the next request off the ring into *req. Returns 0 if there is none. */
+static int server_pop(admission_request *req)
+{
+  admission_page *page = server.page;
+  uint64_t head = page->head;
+  admission_request *cell = &page->ring[head & (ADMISSION_RING - 1)];
+
+  if (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != head + 1) {
+    return 0;
+  }
+  *req = *cell;
+  __atomic_store_n(&cell->seq, head + ADMISSION_RING, __ATOMIC_RELEASE);
+  __atomic_store_n(&page->head, head + 1, __ATOMIC_RELAXED);
+  return 1;
+}
+
+/* 
+* Function: server_request
+* Parameters: req - request taken off the ring
+* Returns: void
+* Description: an enter makes a record for the slot's aircraft and lets it
+*              arrive; a diverted aircraft is answered at once. A leave
+*              clears the slot's aircraft off its runway and frees the slot.
+*              Anything else is counted and dropped. Caller must hold lock.
+ */
+static void server_request(const admission_request *req)
+{
+  aircraft_info *ai = NULL;
+
+  server.requests = server.requests + 1;
+  if (req->op == ADMISSION_SHUTDOWN) {
+    server.shutdown = 1;
+    return;
+  }
+  if (req->slot >= 0 && req->slot < ADMISSION_SLOTS) {
+    ai = server.aircraft[req->slot];
+  }
+  if (req->op == ADMISSION_ENTER && req->slot >= 0 && req->slot < ADMISSION_SLOTS && ai == NULL
+      && req->type >= COMMERCIAL && req->type <= EMERGENCY && req->runway_ms >= 0) {
+    ai = aircraft_alloc();
+    ai->aircraft_type = req->type;
+    ai->runway_time = req->runway_ms;
+    ai->fuel_reserve = req->fuel > 0 ? req->fuel : FUEL_MIN + (rand() % (FUEL_MAX - FUEL_MIN + 1));
+    ai->aircraft_id = server.next_id;
+    ai->slot = req->slot;
+    server.next_id = server.next_id + 1;
+    if (engine_arrive(ai)) {
+      server.aircraft[req->slot] = ai;
+    } else {
+      server_answer(ai, SLOT_DIVERTED);
+      aircraft_free(ai);
+    }
+  } else if (req->op == ADMISSION_LEAVE && ai != NULL && ai->state == AC_ON_RUNWAY) {
+    server.aircraft[req->slot] = NULL;
+    engine_depart(ai);
+    __atomic_store_n(&server.page->slot[req->slot].state, SLOT_FREE, __ATOMIC_RELEASE);
+  } else {
+    server.rejected = server.rejected + 1;
+  }
+}
+
+/* 
+* Function: server_reclaim
+* Parameters: index - slot whose aircraft has entered and not left yet
+*             state - SLOT_DIVERTED to answer a waiting client, SLOT_FREE if
+*                     the client is gone and the slot goes back to the pool
+* Returns: void
+* Description: takes the aircraft back from its client. A waiting one leaves
+*              its queue without being admitted; one on the runway clears it
+*              at once, as if the client had posted its leave. A granted
+*              client is not told: with SLOT_DIVERTED the server is stopping
+*              and nobody reads its leave any more. Caller must hold lock.
+ */
+static void server_reclaim(int index, uint32_t state)
+{
+  aircraft_info *ai = server.aircraft[index];
+  runway *rw = ai->runway;
+
+  server.aircraft[index] = NULL;
+  server.reclaimed = server.reclaimed + 1;
+  if (ai->state == AC_ON_RUNWAY) {
+    engine_depart(ai);
+  } else {
+    assert(ai->state == AC_WAITING);
+    heap_remove(queue_heap_of(&rw->queue[ai->aircraft_type], ai), ai->heap_pos);
+    timer_cancel(&rw->wheel, &ai->deadline_timer);
+    if (ai->critical) {
+      rw->critical_waiting[ai->aircraft_type] = rw->critical_waiting[ai->aircraft_type] - 1;
+    }
+    waiting_add(ai, -1);
+    __atomic_fetch_sub(&rw->load, 1, __ATOMIC_RELAXED);
+    ai->state = AC_DIVERTED;
+    if (state == SLOT_DIVERTED) {
+      server_answer(ai, SLOT_DIVERTED);
+    }
+    aircraft_free(ai);
+  }
+  if (state == SLOT_FREE) {
+    __atomic_store_n(&server.page->slot[index].state, SLOT_FREE, __ATOMIC_RELEASE);
+  }
+}
+
+/* takes back the aircraft of every client process that has died, or of every
+ * client at all once the server is forced to stop. Caller must hold lock. */
+static void server_reap(void)
+{
+  for (int i = 0; i < ADMISSION_SLOTS; i++) {
+    pid_t client = (pid_t)server.page->slot[i].client;
+
+    if (server.aircraft[i] == NULL) {
+      continue;
+    }
+    if (server_force) {
+      server_reclaim(i, SLOT_DIVERTED);
+    } else if (client > 0 && kill(client, 0) != 0 && errno == ESRCH) {
+      server_reclaim(i, SLOT_FREE);
+    }
+  }
+}
+
+/* moves the engine to time now and lets every runway admit and decide */
+static void server_settle(int64_t now)
+{
+  engine.now = now;
+  for (int i = 0; i < num_runways; i++) {
+    wheel_advance(&runways[i].wheel, now);
+  }
+  for (int i = 0; i < num_runways; i++) {
+    engine_admit_waiting(&runways[i]);
+    engine_controller_step(&runways[i]);
+  }
+  engine_wheel_sync();
+}
+
+/* nonzero if a client has published the request the server reads next */
+static int server_pending(void)
+{
+  const admission_page *page = server.page;
+  uint64_t head = page->head;
+
+  return __atomic_load_n(&page->ring[head & (ADMISSION_RING - 1)].seq, __ATOMIC_ACQUIRE) == head + 1;
+}
+
+/* 
+* Function: server_sleep
+* Returns: void
+* Description: sleeps on the doorbell until a client rings it, the next
+*              engine event is due or SERVER_IDLE_MS have passed. sleeping is
+*              set before the ring is looked at for the last time, so a client
+*              that posts after that look sees it and rings. Caller must hold
+*              lock, which is released meanwhile.
+ */
+static void server_sleep(void)
+{
+  admission_page *page = server.page;
+  int64_t until = monotonic_ns() + SERVER_IDLE_MS * NSEC_PER_MSEC;
+  uint32_t doorbell = __atomic_load_n(&page->doorbell, __ATOMIC_ACQUIRE);
+  struct timespec ts;
+
+  if (engine.heap_len > 0 && engine.epoch + engine.heap[0].time < until) {
+    until = engine.epoch + engine.heap[0].time;
+  }
+  ts.tv_sec = until / NSEC_PER_SEC;
+  ts.tv_nsec = until % NSEC_PER_SEC;
+
+  __atomic_store_n(&page->sleeping, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (!server_pending()) {
+    lock_release(&lock);
+    futex_wait(&page->doorbell, doorbell, &ts);
+    lock_acquire(&lock);
+    server.sleeps = server.sleeps + 1;
+  }
+  __atomic_store_n(&page->sleeping, 0, __ATOMIC_RELAXED);
+}
+
+/* 
+* Function: server_loop
+* Returns: void
+* Description: handles engine events as they fall due and client requests as
+*              they arrive, each under the global lock, until a client or a
+*              signal asks the server to stop and every aircraft has cleared.
+*              The page is closed to new aircraft from then on; any enter
+*              still on the ring at the end is answered SLOT_DIVERTED. Every
+*              SERVER_REAP_MS, and at once when a second signal forces the
+*              stop, server_reap() takes back aircraft whose client cannot
+*              clear them any more.
+ */
+static void server_loop(void)
+{
+  admission_request req;
+  int64_t active = monotonic_ns();
+  int64_t reap = active + SERVER_REAP_MS * NSEC_PER_MSEC;
+
+  lock_acquire(&lock);
+  while ((!server.shutdown && !server_stop) || arena.in_flight > 0) {
+    int64_t now = monotonic_ns() - engine.epoch;
+    sim_event ev;
+
+    if (server.shutdown || server_stop) {
+      __atomic_store_n(&server.page->closed, 1, __ATOMIC_RELEASE);
+    }
+    if (server_force || monotonic_ns() >= reap) {
+      server_reap();
+      server_settle(now);
+      reap = monotonic_ns() + SERVER_REAP_MS * NSEC_PER_MSEC;
+      if (server_force) {
+        continue;
+      }
+    }
+    if (engine.heap_len > 0 && engine_wheel_stale(&engine.heap[0])) {
+      engine_next_event(&ev);
+      continue;
+    } else if (engine.heap_len > 0 && engine.heap[0].time <= now) {
+      engine_next_event(&ev);
+      engine.now = ev.time;
+      engine_handle(&ev);
+      server_settle(ev.time);
+    } else if (server_pop(&req)) {
+      engine.now = now;
+      server_request(&req);
+      server_settle(now);
+      active = monotonic_ns();
+    } else if (monotonic_ns() - active < SERVER_SPIN_NS) {
+      // poll the ring without the lock for the rest of the spin
+      lock_release(&lock);
+      while (!server_pending() && monotonic_ns() - active < SERVER_SPIN_NS) {
+        sched_yield();
+      }
+      lock_acquire(&lock);
+      continue;
+    } else {
+      server_sleep();
+      active = monotonic_ns();
+      continue;
+    }
+
+    // every event and request is a critical section of its own, as in engine_worker()
+    lock_release(&lock);
+    lock_acquire(&lock);
+  }
+
+  __atomic_store_n(&server.page->closed, 1, __ATOMIC_RELEASE);
+  engine.now = monotonic_ns() - engine.epoch;
+  while (server_pop(&req)) {
+    if (req.op == ADMISSION_ENTER && req.slot >= 0 && req.slot < ADMISSION_SLOTS) {
+      server_publish(req.slot, SLOT_DIVERTED, NULL);
+    }
+  }
+  lock_release(&lock);
+  log_detach();
+}
+
+/* 
+* Function: server_open
+* Returns: int - 0 on success, 1 if the shared memory object could not be set up
+* Description: creates the -A shared memory object, readable and writable by
+*              this user only, with every ring cell ready for its first lap
+*              and every slot free.
+ */
+static int server_open(void)
+{
+  int fd = shm_open(server.name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if (fd < 0 || ftruncate(fd, sizeof(admission_page)) != 0) {
+    printf("runway: cannot create shared memory %s: %s\n", server.name, strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return 1;
+  }
+  server.page = mmap(NULL, sizeof(admission_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (server.page == MAP_FAILED) {
+    printf("runway: cannot map shared memory %s: %s\n", server.name, strerror(errno));
+    shm_unlink(server.name);
+    return 1;
+  }
+  for (int i = 0; i < ADMISSION_RING; i++) {
+    server.page->ring[i].seq = i;
+  }
+  server.page->pid = (int32_t)getpid();
+  __atomic_store_n(&server.page->magic, ADMISSION_MAGIC, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* 
+* Function: server_run
+* Parameters: event_log_to, timeline_to, stats_to - as for a simulation, or NULL
+* Returns: int - 0 on success, 1 on error
+* Description: serves clients until told to stop, then prints the usual
+*              statistics for the aircraft they flew and removes the object.
+ */
+static int server_run(const char *event_log_to, const char *timeline_to, const char *stats_to)
+{
+  struct sigaction sa;
+  int result;
+
+  sim_mode = MODE_SERVER;
+  initialize(NULL);
+  if (server_open() != 0) {
+    return 1;
+  }
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = server_signal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  if (num_runways > 1) {
+    printf("Serving runway admissions on %s with %d runways (seed %u) ...\n", server.name,
+           num_runways, sim_seed);
+  } else {
+    printf("Serving runway admissions on %s (seed %u) ...\n", server.name, sim_seed);
+  }
+  fflush(stdout);
+
+  sim_epoch = monotonic_ns();
+  memset(&engine, 0, sizeof(engine));
+  engine.real_time = 1;
+  engine.epoch = sim_epoch;
+  engine.wheel_event = -1;
+  log_start(event_log_to, timeline_to);
+  if (metrics_start() != 0) {
+    return 1;
+  }
+  for (int i = 0; i < num_runways; i++) {
+    log_emit(LOG_CONTROLLER_START, i, -1, -1, 0, 0);
+  }
+
+  server_loop();
+  log_stop();
+  metrics_stop();
+
+  printf("Admission server: %llu requests (%llu rejected), %d aircraft (%d reclaimed), "
+         "%llu sleeps, %llu client wakeups\n", (unsigned long long)server.requests,
+         (unsigned long long)server.rejected, server.next_id, server.reclaimed,
+         (unsigned long long)server.sleeps, (unsigned long long)server.wakeups);
+  print_deadline_report();
+  result = print_stats(stats_to);
+  printf("Runway simulation done.\n");
+
+  munmap(server.page, sizeof(admission_page));
+  shm_unlink(server.name);
+  free(engine.heap);
+  arena_destroy();
+  return result;
+}
+
+/*** Parameter sweep ***/
+
+/* -p name=lo-hi[:step] turns the run into a sweep over every combination of
+ * the given parameter ranges. Each combination runs on the virtual clock in a
+ * forked child, so runs share nothing but the trace file and each has the
+ * whole simulation state to itself; up to -j children run at once. Every run
+ * uses the same seed, so all of them see the same fuel reserves.
+ */
+
+#define SWEEP_PARAMS 7
+
+static const struct
+{
+  const char *name;        // as given to -p
+  const char *heading;     // column heading in the sweep table
+  size_t offset;           // field in sim_params
+  int scale;               // stored units per unit given: MSEC_PER_SEC for times
+  int min;                 // smallest value allowed, in stored units
+  int max;                 // largest value allowed
+} param_info[SWEEP_PARAMS] = {
+  { "capacity",         "cap",    offsetof(sim_params, capacity),         1,            1, CAPACITY_MAX },
+  { "controller_limit", "brk@",   offsetof(sim_params, controller_limit), 1,            1, 1000000 },
+  { "direction_limit",  "dir@",   offsetof(sim_params, direction_limit),  1,            1, 1000000 },
+  { "type_limit",       "type@",  offsetof(sim_params, type_limit),       1,            1, 1000000 },
+  { "switch_time",      "switch", offsetof(sim_params, switch_time),      MSEC_PER_SEC, 0, 3600 * MSEC_PER_SEC },
+  { "break_time",       "break",  offsetof(sim_params, break_time),       MSEC_PER_SEC, 0, 3600 * MSEC_PER_SEC },
+  { "fairness",         "fair",   offsetof(sim_params, fairness),         MSEC_PER_SEC, 1, 3600 * MSEC_PER_SEC },
+};
+
+typedef struct
+{
+  int lo;
+  int hi;
+  int step;
+} param_range;
+
+typedef struct
+{
+  sim_params params;
+  double per_hour;         // aircraft admitted per simulated hour
+  int64_t p50;             // wait for the runway over all aircraft, in nanoseconds
+  int64_t p99;
+  int64_t p999;
+  int64_t max;
+  int misses;              // aircraft admitted after their deadline
+  int switches;
+  int breaks;
+  int stranded;            // aircraft left waiting, -1 if the run failed
+} sweep_result;
+
+static param_range sweep_ranges[SWEEP_PARAMS];
+
+static int *param_field(sim_params *p, int i)
+{
+  return (int *)((char *)p + param_info[i].offset);
+}
+
+/* writes a value of parameter i the way -p takes it, times in seconds */
+static const char *param_string(char *buf, size_t size, int i, int value)
+{
+  if (param_info[i].scale == MSEC_PER_SEC) {
+    return ms_string(buf, size, value);
+  }
+  snprintf(buf, size, "%d", value);
+  return buf;
+}
+
+/* parses a value of parameter i at *p into stored units; times may have up to three decimals */
+static int param_value(const char **p, int i, int *value)
+{
+  char *end;
+  long whole = strtol(*p, &end, 10);
+  long v;
+
+  if (end == *p || whole < 0 || whole > param_info[i].max / param_info[i].scale) {
+    return 0;
+  }
+  v = whole * param_info[i].scale;
+  if (*end == '.' && param_info[i].scale == MSEC_PER_SEC) {
+    end = end + 1;
+    for (int scale = MSEC_PER_SEC / 10; *end >= '0' && *end <= '9'; scale = scale / 10) {
+      v = v + (*end - '0') * scale;
+      end = end + 1;
+    }
+  }
+  *value = (int)v;
+  *p = end;
+  return 1;
+}
+
+/* 
+* Function: param_parse
+* Parameters: arg - "name=value" or "name=lo-hi[:step]"
+* Returns: int - 1 if arg names a parameter and a valid value or range, 0 otherwise
+* Description: records a value or range for one of the simulation parameters.
+*              A single value simply replaces the default for this run.
+ */
+static int param_parse(const char *arg)
+{
+  const char *eq = strchr(arg, '=');
+  const char *p;
+  param_range r;
+
+  if (eq == NULL) {
+    return 0;
+  }
+  for (int i = 0; i < SWEEP_PARAMS; i++) {
+    if (strlen(param_info[i].name) != (size_t)(eq - arg)
+        || strncmp(arg, param_info[i].name, eq - arg) != 0) {
+      continue;
+    }
+    p = eq + 1;
+    r.step = param_info[i].scale;
+    if (!param_value(&p, i, &r.lo)) {
+      return 0;
+    }
+    r.hi = r.lo;
+    if (*p == '-' && (p = p + 1, !param_value(&p, i, &r.hi))) {
+      return 0;
+    }
+    if (*p == ':' && (p = p + 1, !param_value(&p, i, &r.step))) {
+      return 0;
+    }
+    if (*p != '\0' || r.lo < param_info[i].min || r.hi > param_info[i].max || r.hi < r.lo
+        || r.step < 1) {
+      return 0;
+    }
+    sweep_ranges[i] = r;
+    *param_field(&params, i) = r.lo;
+    return 1;
+  }
+  return 0;
+}
+
+/* nonzero if any -p gave a range rather than a single value */
+static int sweep_requested(void)
+{
+  for (int i = 0; i < SWEEP_PARAMS; i++) {
+    if (sweep_ranges[i].hi > sweep_ranges[i].lo) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* every parameter not given with -p is swept over just its current value */
+static int sweep_combinations(void)
+{
+  int count = 1;
+
+  for (int i = 0; i < SWEEP_PARAMS; i++) {
+    if (sweep_ranges[i].step == 0) {
+      sweep_ranges[i].lo = sweep_ranges[i].hi = *param_field(&params, i);
+      sweep_ranges[i].step = 1;
+    }
+    count = count * ((sweep_ranges[i].hi - sweep_ranges[i].lo) / sweep_ranges[i].step + 1);
+  }
+  return count;
+}
+
+/* the k-th combination, the last parameter varying fastest */
+static sim_params sweep_params(int k)
+{
+  sim_params p = params;
+
+  for (int i = SWEEP_PARAMS - 1; i >= 0; i--) {
+    int values = (sweep_ranges[i].hi - sweep_ranges[i].lo) / sweep_ranges[i].step + 1;
+
+    *param_field(&p, i) = sweep_ranges[i].lo + (k % values) * sweep_ranges[i].step;
+    k = k / values;
+  }
+  return p;
+}
+
+/* 
+* Function: sweep_child
+* Parameters: filename - trace to run
+*             seed - seed for the fuel reserves
+*             fd - pipe to write the sweep_result to
+* Returns: never, the child exits
+* Description: one run of the sweep with the parameters already set in params.
+*              The event log is discarded; only the summary goes back.
+ */
+static void sweep_child(const char *filename, unsigned seed, int fd)
+{
+  static histogram all;
+  sweep_result r;
+  const runway_stats *total;
+  int64_t elapsed;
+
+  memset(&r, 0, sizeof(r));
+  r.params = params;
+  sim_mode = MODE_VIRTUAL;
+  if (initialize((char *)filename) <= 0) {
+    r.stranded = -1;
+  } else {
+    srand(seed);
+    sim_epoch = monotonic_ns();
+    log_start("/dev/null", NULL);
+    r.stranded = engine_run(MODE_VIRTUAL, 1);
+    log_stop();
+
+    elapsed = sim_now();
+    total = stats_total();
+    memset(&all, 0, sizeof(all));
+    for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+      hist_merge(&all, &total->wait[type]);
+      r.misses = r.misses + total->deadline_misses[type];
+    }
+    r.per_hour = elapsed > 0 ? all.total * 3600.0 / seconds(elapsed) : 0.0;
+    r.p50 = hist_percentile(&all, 0.5);
+    r.p99 = hist_percentile(&all, 0.99);
+    r.p999 = hist_percentile(&all, 0.999);
+    r.max = all.max;
+    r.switches = total->pause[PAUSE_SWITCH].count;
+    r.breaks = total->pause[PAUSE_BREAK].count;
+  }
+  if (write(fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) {
+    _exit(1);
+  }
+  _exit(0);
+}
+
+/* waits for any sweep child and collects its result */
+static void sweep_reap(pid_t *pids, int *fds, sweep_result *results, int count)
+{
+  int status;
+  pid_t pid = wait(&status);
+
+  for (int k = 0; k < count; k++) {
+    if (pids[k] != pid || pid <= 0) {
+      continue;
+    }
+    if (read(fds[k], &results[k], sizeof(sweep_result)) != (ssize_t)sizeof(sweep_result)) {
+      results[k].params = sweep_params(k);
+      results[k].stranded = -1;
+    }
+    close(fds[k]);
+    pids[k] = 0;
+    return;
+  }
+}
+
+/* 
+* Function: sweep_run
+* Parameters: filename - trace every combination is run on
+*             workers - most runs at a time
+* Returns: int - 0 if every run completed, 1 otherwise
+* Description: runs every combination of the -p ranges and prints a table of
+*              throughput, wait percentiles, deadline misses, switches and
+*              breaks, marking the combination with the highest throughput.
+ */
+static int sweep_run(const char *filename, int workers)
+{
+  int count = sweep_combinations();
+  unsigned seed = sim_seed;
+  sweep_result *results = calloc(count, sizeof(sweep_result));
+  pid_t *pids = calloc(count, sizeof(pid_t));
+  int *fds = calloc(count, sizeof(int));
+  int running = 0;
+  int best = -1;
+  int failed = 0;
+  char value[24];
+
+  if (results == NULL || pids == NULL || fds == NULL) {
+    printf("runway: out of memory for %d sweep runs\n", count);
+    exit(1);
+  }
+  printf("Sweeping %d parameter combinations on %d workers ...\n", count, workers);
+  fflush(stdout);  // or every child flushes a copy of it
+
+  for (int k = 0; k < count; k++) {
+    int pipefd[2];
+
+    if (running == workers) {
+      sweep_reap(pids, fds, results, count);
+      running = running - 1;
+    }
+    if (pipe(pipefd) != 0 || (pids[k] = fork()) < 0) {
+      printf("runway: cannot start sweep run %d: %s\n", k, strerror(errno));
+      exit(1);
+    }
+    if (pids[k] == 0) {
+      close(pipefd[0]);
+      params = sweep_params(k);
+      sweep_child(filename, seed, pipefd[1]);
+    }
+    close(pipefd[1]);
+    fds[k] = pipefd[0];
+    running = running + 1;
+  }
+  while (running > 0) {
+    sweep_reap(pids, fds, results, count);
+    running = running - 1;
+  }
+
+  // highest throughput wins, the shorter p99 wait among equals
+  for (int k = 0; k < count; k++) {
+    sweep_result *r = &results[k];
+
+    if (r->stranded == 0 && (best < 0 || r->per_hour > results[best].per_hour
+                             || (r->per_hour == results[best].per_hour
+                                 && r->p99 < results[best].p99))) {
+      best = k;
+    }
+  }
+  for (int i = 0; i < SWEEP_PARAMS; i++) {
+    printf("%6s ", param_info[i].heading);
+  }
+  printf("  per hour       p50       p99      p999       max  misses switches  breaks\n");
+  for (int k = 0; k < count; k++) {
+    sweep_result *r = &results[k];
+
+    for (int i = 0; i < SWEEP_PARAMS; i++) {
+      printf("%6s ", param_string(value, sizeof(value), i, *param_field(&r->params, i)));
+    }
+    if (r->stranded != 0) {
+      printf("  %s\n", r->stranded < 0 ? "run failed" : "stalled");
+      failed = failed + 1;
+      continue;
+    }
+    printf("%10.1f %9.3f %9.3f %9.3f %9.3f %7d %8d %7d%s\n", r->per_hour, seconds(r->p50),
+           seconds(r->p99), seconds(r->p999), seconds(r->max), r->misses, r->switches, r->breaks,
+           k == best ? "  *" : "");
+  }
+
+  free(results);
+  free(pids);
+  free(fds);
+  return failed > 0;
+}
+
+/*** Decision record and replay ***/
+
+/* Fuel reserves come from the -S seed, but with aircraft as threads the order
+ * in which they get the runway, and when the controller switches or goes on
+ * break, is up to the OS. -R FILE writes down every such decision as it is
+ * made, one line each, after a header with the seed, the runway count, the
+ * parameters and the packing mode:
+ *
+ *   admit R ID     aircraft ID gets runway R
+ *   switch R       the controller closes runway R for a direction switch ...
+ *   break R        ... or for a break
+ *   drained R      runway R is empty and the switch or break starts
+ *   assign R ID    aircraft ID is sent to runway R (only with several runways)
+ *
+ * -P FILE runs with the header's settings and forces the recorded decisions in
+ * the recorded order on each runway: the policy is wrapped so that only the
+ * next recorded aircraft is admitted, once it is waiting and the rules allow,
+ * and the controller switches or breaks exactly when the record says. The
+ * timing is the machine's own, the order is the recording's. Once a runway's
+ * record runs out, or no longer fits what happens, the policy chosen with -s,
+ * -d and -b takes over.
+ */
+
+typedef struct
+{
+  int kind;                // PAUSE_SWITCH, PAUSE_BREAK, DECIDE_ADMIT or DECIDE_DRAINED
+  int aircraft_id;         // DECIDE_ADMIT only
+} decision;
+
+static struct
+{
+  FILE *record;                    // -R: decisions are written here as they are made
+  decision *stream[MAX_RUNWAYS];   // -P: each runway's decisions in order
+  int len[MAX_RUNWAYS];
+  int next[MAX_RUNWAYS];           // the next one to force, under the runway's lock
+  int draining[MAX_RUNWAYS];       // between a switch or break and its drained
+  int *assign;                     // runway of each aircraft id, -1 if not recorded
+  int assigned;                    // entries in assign
+  sched_policy base;               // takes over once a runway's record runs out
+  int aircraft;                    // in the recorded trace
+} decisions;
+
+static const char *decision_names[] = { "switch", "break", "admit", "drained", "assign" };
+
+/* nonzero while decisions recorded for this runway are still to be forced */
+static int replay_pending(const runway *rw)
+{
+  return decisions.next[rw->id] < decisions.len[rw->id];
+}
+
+/* the next recorded decision for this runway, NULL once there is none */
+static const decision *replay_next(const runway *rw, int ahead)
+{
+  int i = decisions.next[rw->id] + ahead;
+
+  return i < decisions.len[rw->id] ? &decisions.stream[rw->id][i] : NULL;
+}
+
+/* nonzero if aircraft recorded as admitted while the runway drained are still to come */
+static int replay_holds_drain(const runway *rw)
+{
+  const decision *d = replay_next(rw, 0);
+
+  return decisions.draining[rw->id] && d != NULL && d->kind == DECIDE_ADMIT;
+}
+
+/* the runway recorded for an aircraft, NULL if there is none */
+static runway *replay_runway(int aircraft_id)
+{
+  if (aircraft_id < 0 || aircraft_id >= decisions.assigned || decisions.assign[aircraft_id] < 0) {
+    return NULL;
+  }
+  return &runways[decisions.assign[aircraft_id]];
+}
+
+/* gives up the replay of a runway that no longer follows its record */
+static void replay_diverged(const runway *rw)
+{
+  printf("runway: replay of runway %d diverged at decision %d, the %s policy takes over\n",
+         rw->id + 1, decisions.next[rw->id] + 1, decisions.base.name);
+  decisions.next[rw->id] = decisions.len[rw->id];
+  decisions.draining[rw->id] = 0;
+}
+
+/* 
+* Function: decision_made
+* Parameters: rw - runway the decision is about
+*             kind - PAUSE_SWITCH, PAUSE_BREAK or DECIDE_*
+*             aircraft_id - the aircraft admitted or assigned, -1 otherwise
+* Returns: void
+* Description: writes the decision down under -R and, under -P, moves past the
+*              recorded one it carries out. If it is not the one recorded the
+*              replay of this runway is given up. Caller must hold the runway
+*              lock, except for DECIDE_ASSIGN.
+ */
+static void decision_made(const runway *rw, int kind, int aircraft_id)
+{
+  const decision *d;
+
+  if (decisions.record != NULL && (kind != DECIDE_ASSIGN || num_runways > 1)) {
+    if (aircraft_id >= 0) {
+      fprintf(decisions.record, "%s %d %d\n", decision_names[kind], rw->id, aircraft_id);
+    } else {
+      fprintf(decisions.record, "%s %d\n", decision_names[kind], rw->id);
+    }
+  }
+  if (kind == DECIDE_ASSIGN || (d = replay_next(rw, 0)) == NULL) {
+    return;
+  }
+  if (d->kind != kind || (kind == DECIDE_ADMIT && d->aircraft_id != aircraft_id)) {
+    replay_diverged(rw);
+    return;
+  }
+  decisions.next[rw->id] = decisions.next[rw->id] + 1;
+  if (kind == PAUSE_SWITCH || kind == PAUSE_BREAK) {
+    decisions.draining[rw->id] = 1;
+  } else if (kind == DECIDE_DRAINED) {
+    decisions.draining[rw->id] = 0;
+  }
+}
+
+/* the recorded next aircraft, once it waits here and the rules let it on */
+static aircraft_info *replay_pick_next(runway *rw)
+{
+  const decision *d = replay_next(rw, 0);
+  uint64_t s = runway_state(rw);
+
+  if (d == NULL) {
+    return decisions.base.pick_next(rw);
+  }
+  if (d->kind != DECIDE_ADMIT) {
+    return NULL;
+  }
+  // a switch or break that has been decided but not started yet still lets
+  // the aircraft recorded before it on
+  if ((s & (STATE_SWITCHING | STATE_BREAK)) && !decisions.draining[rw->id]) {
+    return NULL;
+  }
+  s = s & ~(STATE_SWITCHING | STATE_BREAK);
+  for (int type = COMMERCIAL; type <= EMERGENCY; type++) {
+    aircraft_heap *heaps[2] = { &rw->queue[type].pending, &rw->queue[type].overdue };
+
+    for (int k = 0; k < 2; k++) {
+      for (int i = 0; i < heaps[k]->len; i++) {
+        aircraft_info *ai = heaps[k]->heap[i];
+
+        if (ai->aircraft_id != d->aircraft_id) {
+          continue;
+        }
+        if (state_admits(s, type)) {
+          return ai;
+        }
+        // it waits on an empty, open runway and still cannot get on:
+        // nothing recorded can change that any more
+        if (state_count(s, -1) == 0 && !decisions.draining[rw->id]) {
+          replay_diverged(rw);
+          return decisions.base.pick_next(rw);
+        }
+        return NULL;
+      }
+    }
+  }
+  return NULL;
+}
+
+static int replay_should_switch(const runway *rw)
+{
+  const decision *d = replay_next(rw, 0);
+
+  if (d == NULL) {
+    return decisions.base.should_switch(rw);
+  }
+  // when the chosen policy would, or once the runway is empty and someone
+  // waits if it would not: the record says nobody else gets on before it
+  return d->kind == PAUSE_SWITCH
+         && (decisions.base.should_switch(rw) || (on_runway(rw) == 0 && (runway_state(rw) & STATE_QUEUED)));
+}
+
+static int replay_should_break(const runway *rw, int switching)
+{
+  const decision *d = replay_next(rw, 0);
+
+  if (d == NULL) {
+    return decisions.base.should_break(rw, switching);
+  }
+  if (switching) {
+    d = replay_next(rw, 1);
+    return d != NULL && d->kind == PAUSE_BREAK;
+  }
+  return d->kind == PAUSE_BREAK;
+}
+
+/* starts writing decisions to a -R file, after a header for -P to apply */
+static int decisions_record(const char *filename, int num_aircraft)
+{
+  char value[24];
+
+  if ((decisions.record = fopen(filename, "w")) == NULL) {
+    printf("Cannot open decision record %s for writing.\n", filename);
+    return 1;
+  }
+  fprintf(decisions.record, "# runway decisions: aircraft=%d seed=%u runways=%d pack=%s hold=%d",
+          num_aircraft, sim_seed, num_runways, pack_mode == PACK_FILL ? "fill" : "none", holding_depth);
+  for (int i = 0; i < SWEEP_PARAMS; i++) {
+    fprintf(decisions.record, " %s=%s", param_info[i].name,
+            param_string(value, sizeof(value), i, *param_field(&params, i)));
+  }
+  fprintf(decisions.record, "\n");
+  return 0;
+}
+
+/* 
+* Function: decisions_replay
+* Parameters: filename - a record written with -R
+* Returns: int - 0 on success, 1 if the record cannot be used
+* Description: loads the record, applies the seed, runway count, parameters,
+*              packing mode and holding stack of its header, and wraps the
+*              policy so that the recorded decisions are forced. Waiting aircraft are then
+*              only ever admitted by the controller's choice, so broadcast
+*              wakeups are turned off.
+ */
+static int decisions_replay(const char *filename)
+{
+  FILE *in = fopen(filename, "r");
+  char line[256];
+  char word[16];
+  int r;
+  int id;
+  int fields;
+
+  if (in == NULL) {
+    printf("Cannot open decision record %s.\n", filename);
+    return 1;
+  }
+  if (fgets(line, sizeof(line), in) == NULL || strncmp(line, "# runway decisions:", 19) != 0) {
+    printf("%s is not a decision record.\n", filename);
+    fclose(in);
+    return 1;
+  }
+  for (char *tok = strtok(line + 19, " \n"); tok != NULL; tok = strtok(NULL, " \n")) {
+    if (sscanf(tok, "seed=%u", &sim_seed) == 1 || sscanf(tok, "runways=%d", &num_runways) == 1
+        || sscanf(tok, "aircraft=%d", &decisions.aircraft) == 1
+        || sscanf(tok, "hold=%d", &holding_depth) == 1) {
+      continue;
+    }
+    if (strncmp(tok, "pack=", 5) == 0) {
+      pack_mode = strcmp(tok + 5, "fill") == 0 ? PACK_FILL : PACK_NONE;
+    } else if (!param_parse(tok)) {
+      printf("%s: bad setting %s in the header.\n", filename, tok);
+      fclose(in);
+      return 1;
+    }
+  }
+  if (num_runways < 1 || num_runways > MAX_RUNWAYS) {
+    printf("%s: bad runway count %d.\n", filename, num_runways);
+    fclose(in);
+    return 1;
+  }
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    decision d = { -1, -1 };
+
+    fields = sscanf(line, "%15s %d %d", word, &r, &id);
+    for (int kind = PAUSE_SWITCH; kind <= DECIDE_ASSIGN; kind++) {
+      if (fields >= 2 && strcmp(word, decision_names[kind]) == 0) {
+        d.kind = kind;
+      }
+    }
+    if (d.kind < 0 || r < 0 || r >= num_runways
+        || ((d.kind == DECIDE_ADMIT || d.kind == DECIDE_ASSIGN) && (fields < 3 || id < 0))) {
+      printf("%s: bad decision: %s", filename, line);
+      fclose(in);
+      return 1;
+    }
+    if (d.kind == DECIDE_ASSIGN) {
+      if (id >= decisions.assigned) {
+        int grown = id + 1 > 2 * decisions.assigned ? id + 1 : 2 * decisions.assigned;
+
+        decisions.assign = realloc(decisions.assign, grown * sizeof(int));
+        for (int i = decisions.assigned; i < grown; i++) {
+          decisions.assign[i] = -1;
+        }
+        decisions.assigned = grown;
+      }
+      decisions.assign[id] = r;
+      continue;
+    }
+    if (d.kind == DECIDE_ADMIT) {
+      d.aircraft_id = id;
+    }
+    if ((decisions.len[r] & (decisions.len[r] - 1)) == 0) {
+      decisions.stream[r] = realloc(decisions.stream[r],
+                                    (decisions.len[r] ? 2 * decisions.len[r] : 64) * sizeof(decision));
+    }
+    decisions.stream[r][decisions.len[r]] = d;
+    decisions.len[r] = decisions.len[r] + 1;
+  }
+  fclose(in);
+
+  decisions.base = policy;
+  policy.name = "replay";
+  policy.pick_next = replay_pick_next;
+  policy.should_switch = replay_should_switch;
+  policy.should_break = replay_should_break;
+  wakeup_mode = WAKE_TARGETED;
+  return 0;
+}
+
+/* nonzero if -d plan needs the arrivals forecast, under a replay too */
+static int plan_forecast(void)
+{
+  return policy.should_switch == switch_on_plan || decisions.base.should_switch == switch_on_plan;
+}
+
+/* closes the -R file at the end of the run */
+static void decisions_finish(void)
+{
+  if (decisions.record != NULL) {
+    fclose(decisions.record);
+    decisions.record = NULL;
+  }
+}
+
+/*** Offline schedule bound ***/
+
+/* How far is the online scheduler from the best possible? -O N takes the trace
+ * of a single-runway run once it is over, with all arrivals known in advance,
+ * and searches for the schedule with the shortest makespan (the last aircraft
+ * clears) and, separately, the one with the least total wait. The rules are
+ * those every policy keeps with the default -d limits:
+ *
+ *   at most capacity aircraft at once, commercial ones only NORTH, cargo only
+ *   SOUTH, emergencies either way; a direction switch or a break needs an
+ *   empty runway and lasts switch_time or break_time seconds, or the longer of
+ *   the two if taken together; a break before more than controller_limit
+ *   aircraft in a row; no more than direction_limit aircraft in a row in one
+ *   direction while aircraft for the other direction wait, other than ones
+ *   that clear before the runway would be empty anyway (-f fill); emergencies
+ *   on the runway within EMERGENCY_TIMEOUT seconds of arriving
+ *
+ * but any admission order, and breaks whenever the runway is empty. Fuel
+ * deadlines are left out: they are random. The search is a depth-first branch
+ * and bound over the next move (admit one of the waiting aircraft at the
+ * earliest moment it can go, switch, take a break, or both), cut off at N
+ * nodes. Subtrees are pruned with a lower bound built from the remaining
+ * runway time spread over all slots plus the switches and breaks still
+ * needed. Subtrees left unexplored when the budget runs out keep their lower
+ * bound, so the report gives the best schedule found and a proven bound on
+ * the best possible one, and calls the schedule optimal when they meet.
+ */
+
+#define OFFLINE_MAX_AIRCRAFT 256     /* Longest trace -O searches; every level of the search holds one per aircraft */
+#define OFFLINE_MAKESPAN     0
+#define OFFLINE_WAIT         1
+
+typedef struct
+{
+  int64_t t;               // no admission before this, the time of the previous move
+  int64_t busy[CAPACITY_MAX]; // when each slot is free again
+  int64_t makespan;        // so far: last finish
+  int64_t wait;            // so far: total wait of the admitted aircraft
+  int direction;
+  int consecutive;         // aircraft in a row in this direction
+  int since_break;
+  int left;                // aircraft not admitted yet
+  int paused;              // the last move was a switch or a break
+} offline_node;
+
+static struct
+{
+  int n;
+  int64_t *arrival;        // milliseconds from the start, in trace order
+  int *runway_time;        // milliseconds
+  int *type;
+  char *done;              // admitted in the current branch
+  int objective;           // OFFLINE_MAKESPAN or OFFLINE_WAIT
+  int deadlines;           // emergency admission windows are enforced
+  long budget;             // nodes the search may expand
+  long nodes;
+  int64_t best;            // best complete schedule found, INT64_MAX before the first
+  int64_t open_bound;      // least bound of the subtrees the budget cut off
+} offline;
+
+static int offline_slot(const offline_node *x, int latest)
+{
+  int k = 0;
+
+  for (int i = 1; i < params.capacity; i++) {
+    if (latest ? x->busy[i] > x->busy[k] : x->busy[i] < x->busy[k]) {
+      k = i;
+    }
+  }
+  return k;
+}
+
+/* nonzero if aircraft j may use the runway in the given direction */
+static int offline_fits(int j, int direction)
+{
+  return offline.type[j] == EMERGENCY || offline.type[j] == (direction == NORTH ? COMMERCIAL : CARGO);
+}
 
-  /* Leave runway */
-  commercial_leave();  
+/* the earliest aircraft j could start from node x, not counting the other waiters */
+static int64_t offline_earliest(const offline_node *x, int j)
+{
+  int64_t empty = x->busy[offline_slot(x, 1)];
+  int64_t start = x->t;
+
+  empty = empty > x->t ? empty : x->t;
+  if (!offline_fits(j, x->direction)) {
+    // a switch first, taken with the break if one is due
+    start = empty + (x->since_break >= params.controller_limit && params.break_time > params.switch_time
+                     ? params.break_time : params.switch_time);
+  } else if (x->since_break >= params.controller_limit) {
+    start = empty + params.break_time;
+  } else if (x->busy[offline_slot(x, 0)] > start) {
+    start = x->busy[offline_slot(x, 0)];
+  }
+  return start > offline.arrival[j] ? start : offline.arrival[j];
+}
 
-  printf("Commercial aircraft %d has cleared the runway\n", ai->aircraft_id);
+/* the switches and breaks that take at least this long away from cnt aircraft
+ * of which some need each direction (both), after since_break already */
+static int64_t offline_pauses(int cnt, int since_break, int both)
+{
+  int breaks = (since_break + cnt + params.controller_limit - 1) / params.controller_limit - 1;
+  int64_t pause = (int64_t)breaks * params.break_time;
 
-  if (!(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0)) {
-    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", aircraft_on_runway, MAX_RUNWAY_CAPACITY);
-    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n", 
-           commercial_on_runway, cargo_on_runway, emergency_on_runway,
-           current_direction == NORTH ? "NORTH" : "SOUTH");
+  if (both) {
+    pause = pause + (breaks == 0 ? params.switch_time
+                     : params.switch_time > params.break_time ? params.switch_time - params.break_time : 0);
   }
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
+  return pause;
+}
 
-  pthread_exit(NULL);
+static int offline_compare(const void *a, const void *b)
+{
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+
+  return (x > y) - (x < y);
 }
 
-/* Main code for cargo aircraft threads.
- * You do not need to change anything here, but you can add
- * debug statements to help you during development/debugging.
+/* 
+* Function: offline_bound
+* Parameters: x - a partial schedule
+* Returns: int64_t - no completion of x does better than this
+* Description: for the makespan, the latest earliest finish of any aircraft
+*              left, and for every arrival time the runway time of the
+*              aircraft arriving from then on spread over every slot, plus the
+*              breaks and the switch those still need. For the total wait, the
+*              aircraft left are started in the order they could first start,
+*              each on the first free slot and as if it needed the runway for
+*              only the shortest runway time left: no real order starts the
+*              first k of them any earlier, for every k.
  */
-void* cargo_aircraft(void *ai_ptr) 
+static int64_t offline_bound(const offline_node *x)
 {
-  aircraft_info *ai = (aircraft_info*)ai_ptr;
-  
-  /* Record arrival time for fuel tracking */
-  ai->arrival_timestamp = time(NULL);
+  int64_t bound = offline.objective == OFFLINE_MAKESPAN ? x->makespan : x->wait;
+  int64_t earliest[OFFLINE_MAX_AIRCRAFT];
+  int64_t free_at[CAPACITY_MAX];
+  int64_t work = 0;
+  int64_t shortest = INT64_MAX;
+  int types = 0;
+  int cnt = 0;
 
-  /* Request runway access */
-  cargo_enter(ai);
+  if (x->left == 0) {
+    return bound;
+  }
+  for (int j = offline.n - 1; j >= 0; j--) {
+    int64_t from;
+    int64_t b;
 
-  printf("Cargo aircraft %d (fuel: %ds) is now on the runway (direction: %s)\n", 
-         ai->aircraft_id, ai->fuel_reserve,
-         current_direction == NORTH ? "NORTH" : "SOUTH");
-
-  if (!(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0)) {
-    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", aircraft_on_runway, 
-            MAX_RUNWAY_CAPACITY);
-    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n", 
-           commercial_on_runway, cargo_on_runway, emergency_on_runway,
-           current_direction == NORTH ? "NORTH" : "SOUTH");
-  }
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(commercial_on_runway == 0 ); 
-
-  printf("Cargo aircraft %d begins runway operations for %d seconds\n", 
-         ai->aircraft_id, ai->runway_time);
-  use_runway(ai->runway_time);
-  printf("Cargo aircraft %d completes runway operations and prepares to depart\n", 
-         ai->aircraft_id);
+    if (offline.done[j]) {
+      continue;
+    }
+    earliest[cnt] = offline_earliest(x, j);
+    cnt = cnt + 1;
+    work = work + offline.runway_time[j];
+    types = types | (1 << offline.type[j]);
+    if (offline.runway_time[j] < shortest) {
+      shortest = offline.runway_time[j];
+    }
+    if (offline.objective == OFFLINE_WAIT) {
+      bound = bound - offline.arrival[j];
+      continue;
+    }
+    b = earliest[cnt - 1] + offline.runway_time[j];
+    bound = b > bound ? b : bound;
+    // everything arriving from a[j] on, with a break just before if that helps it most
+    from = offline.arrival[j] > x->t ? offline.arrival[j] : x->t;
+    if (from > x->t) {
+      b = from + (work + params.capacity - 1) / params.capacity
+          + offline_pauses(cnt, 0, (types & 3) == 3);
+      bound = b > bound ? b : bound;
+    }
+  }
 
-  /* Leave runway */
-  cargo_leave();        
+  if (offline.objective == OFFLINE_WAIT) {
+    qsort(earliest, cnt, sizeof(earliest[0]), offline_compare);
+    for (int i = 0; i < params.capacity; i++) {
+      free_at[i] = x->busy[i] > x->t ? x->busy[i] : x->t;
+    }
+    for (int k = 0; k < cnt; k++) {
+      int i = 0;
 
-  printf("Cargo aircraft %d has cleared the runway\n", ai->aircraft_id);
+      for (int m = 1; m < params.capacity; m++) {
+        i = free_at[m] < free_at[i] ? m : i;
+      }
+      free_at[i] = earliest[k] > free_at[i] ? earliest[k] : free_at[i];
+      bound = bound + free_at[i];
+      free_at[i] = free_at[i] + shortest;
+    }
+    return bound;
+  }
 
-  if (!(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0)) {
-    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", 
-           aircraft_on_runway, MAX_RUNWAY_CAPACITY);
-    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n", 
-           commercial_on_runway, cargo_on_runway, emergency_on_runway,
-           current_direction == NORTH ? "NORTH" : "SOUTH");
+  for (int i = 0; i < params.capacity; i++) {
+    work = work + (x->busy[i] > x->t ? x->busy[i] - x->t : 0);
   }
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
+  work = x->t + (work + params.capacity - 1) / params.capacity
+         + offline_pauses(x->left, x->since_break,
+                          (types & (1 << (x->direction == NORTH ? CARGO : COMMERCIAL))) != 0);
+  return work > bound ? work : bound;
+}
 
-  pthread_exit(NULL);
+/* nonzero if an emergency left waiting can no longer make its window from time t */
+static int offline_late(int64_t t)
+{
+  for (int j = 0; offline.deadlines && j < offline.n; j++) {
+    if (!offline.done[j] && offline.type[j] == EMERGENCY
+        && offline.arrival[j] + EMERGENCY_TIMEOUT * MSEC_PER_SEC < t) {
+      return 1;
+    }
+  }
+  return 0;
 }
 
-/* Main code for emergency aircraft threads.
- * You do not need to change anything here, but you can add
- * debug statements to help you during development/debugging.
+/* nonzero if aircraft for the other direction wait when aircraft j starts at
+ * time t; those arriving at t too only count if they come first in the trace */
+static int offline_opposite_waiting(const offline_node *x, int j, int64_t t)
+{
+  int other = x->direction == NORTH ? CARGO : COMMERCIAL;
+
+  for (int k = 0; k < offline.n && (offline.arrival[k] < t || (offline.arrival[k] == t && k < j)); k++) {
+    if (!offline.done[k] && offline.type[k] == other) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* the node after a switch (switch = 1), a break (switch = 0) or both (switch = 2) */
+static offline_node offline_pause(const offline_node *x, int with_switch)
+{
+  offline_node y = *x;
+  int64_t empty = x->busy[offline_slot(x, 1)];
+  int64_t length = with_switch == 1 ? params.switch_time : params.break_time;
+
+  if (with_switch == 2 && params.switch_time > length) {
+    length = params.switch_time;
+  }
+  y.t = (empty > x->t ? empty : x->t) + length;
+  if (with_switch) {
+    y.direction = x->direction == NORTH ? SOUTH : NORTH;
+    y.consecutive = 0;
+  }
+  if (with_switch != 1) {
+    y.since_break = 0;
+  }
+  y.paused = 1;
+  return y;
+}
+
+/* 
+* Function: offline_search
+* Parameters: x - a partial schedule
+* Returns: void
+* Description: tries every move from x, admissions first in the order they
+*              could start, and keeps the best complete schedule in
+*              offline.best. Of several waiting aircraft of the same type and
+*              runway time only the first to arrive is tried.
  */
-void* emergency_aircraft(void *ai_ptr) 
+static void offline_search(const offline_node *x)
 {
-  aircraft_info *ai = (aircraft_info*)ai_ptr;
-  
-  /* Record arrival time for fuel and emergency timeout tracking */
-  ai->arrival_timestamp = time(NULL);
+  int64_t bound = offline_bound(x);
+  int order[OFFLINE_MAX_AIRCRAFT];
+  int64_t start[OFFLINE_MAX_AIRCRAFT];
+  int count = 0;
+  int other = 0;
 
-  /* Request runway access */
-  emergency_enter(ai);
+  if (bound >= offline.best) {
+    return;
+  }
+  if (x->left == 0) {
+    offline.best = bound;
+    return;
+  }
+  if (offline.nodes >= offline.budget) {
+    if (bound < offline.open_bound) {
+      offline.open_bound = bound;
+    }
+    return;
+  }
+  offline.nodes = offline.nodes + 1;
+
+  for (int j = 0; j < offline.n; j++) {
+    int seen = 0;
+    int64_t s;
+
+    if (offline.done[j]) {
+      continue;
+    }
+    if (!offline_fits(j, x->direction)) {
+      other = 1;
+      continue;
+    }
+    if (x->since_break >= params.controller_limit) {
+      continue;
+    }
+    for (int i = 0; i < count && !seen; i++) {
+      seen = offline.type[order[i]] == offline.type[j]
+             && offline.runway_time[order[i]] == offline.runway_time[j];
+    }
+    s = offline_earliest(x, j);
+    // past the direction limit only what clears before the runway empties anyway, as -f fill does
+    if (seen || offline_late(s)
+        || (x->consecutive >= params.direction_limit && offline_opposite_waiting(x, j, s)
+            && s + offline.runway_time[j] > x->busy[offline_slot(x, 1)])) {
+      continue;
+    }
+    // insertion sort by start time, then trace order
+    int i = count;
+    while (i > 0 && start[i - 1] > s) {
+      order[i] = order[i - 1];
+      start[i] = start[i - 1];
+      i = i - 1;
+    }
+    order[i] = j;
+    start[i] = s;
+    count = count + 1;
+  }
 
-  printf("EMERGENCY aircraft %d (fuel: %ds) is now on the runway (direction: %s)\n", 
-         ai->aircraft_id, ai->fuel_reserve,
-         current_direction == NORTH ? "NORTH" : "SOUTH");
+  for (int i = 0; i < count; i++) {
+    int j = order[i];
+    offline_node y = *x;
+    int k = offline_slot(x, 0);
 
-  if (!(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0)) {
-    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", aircraft_on_runway, 
-            MAX_RUNWAY_CAPACITY);
-    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n", 
-           commercial_on_runway, cargo_on_runway, emergency_on_runway,
-           current_direction == NORTH ? "NORTH" : "SOUTH");
+    y.t = start[i];
+    y.busy[k] = start[i] + offline.runway_time[j];
+    y.makespan = y.busy[k] > x->makespan ? y.busy[k] : x->makespan;
+    y.wait = x->wait + (start[i] - offline.arrival[j]);
+    y.consecutive = x->consecutive + 1;
+    y.since_break = x->since_break + 1;
+    y.left = x->left - 1;
+    y.paused = 0;
+    offline.done[j] = 1;
+    offline_search(&y);
+    offline.done[j] = 0;
   }
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
 
-  printf("EMERGENCY aircraft %d begins runway operations for %d seconds\n", 
-         ai->aircraft_id, ai->runway_time);
-  use_runway(ai->runway_time);
-  printf("EMERGENCY aircraft %d completes runway operations and prepares to depart\n", 
-         ai->aircraft_id);
+  // a switch, a break or both, never two in a row
+  if (!x->paused) {
+    offline_node y;
 
-  /* Leave runway */
-  emergency_leave();        
+    if (other) {
+      y = offline_pause(x, 1);
+      if (x->since_break < params.controller_limit && !offline_late(y.t)) {
+        offline_search(&y);
+      }
+      y = offline_pause(x, 2);
+      if (x->since_break > 0 && !offline_late(y.t)) {
+        offline_search(&y);
+      }
+    }
+    y = offline_pause(x, 0);
+    if (x->since_break > 0 && !offline_late(y.t)) {
+      offline_search(&y);
+    }
+  }
+}
 
-  printf("EMERGENCY aircraft %d has cleared the runway\n", ai->aircraft_id);
+/* searches for the best schedule for one objective; returns 0 if there is none within the rules */
+static int offline_solve(int objective, long budget)
+{
+  offline_node root;
 
-  if (!(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0)) {
-    printf("ASSERT FAILURE: aircraft_on_runway=%d (should be 0-%d)\n", 
-           aircraft_on_runway, MAX_RUNWAY_CAPACITY);
-    printf("Runway state: commercial=%d, cargo=%d, emergency=%d, direction=%s\n", 
-           commercial_on_runway, cargo_on_runway, emergency_on_runway,
-           current_direction == NORTH ? "NORTH" : "SOUTH");
+  memset(&root, 0, sizeof(root));
+  root.direction = NORTH;
+  root.left = offline.n;
+  memset(offline.done, 0, offline.n);
+  offline.objective = objective;
+  offline.budget = budget;
+  offline.nodes = 0;
+  offline.best = INT64_MAX;
+  offline.open_bound = INT64_MAX;
+  offline_search(&root);
+  if (offline.open_bound > offline.best) {
+    offline.open_bound = offline.best;  // every subtree was searched or beaten
   }
-  assert(aircraft_on_runway <= MAX_RUNWAY_CAPACITY && aircraft_on_runway >= 0);
-  assert(commercial_on_runway >= 0 && commercial_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(cargo_on_runway >= 0 && cargo_on_runway <= MAX_RUNWAY_CAPACITY);
-  assert(emergency_on_runway >= 0 && emergency_on_runway <= MAX_RUNWAY_CAPACITY);
+  if (offline.open_bound < offline_bound(&root)) {
+    offline.open_bound = offline_bound(&root);  // just as true, and sometimes better
+  }
+  return offline.best < INT64_MAX || offline.open_bound < INT64_MAX;
+}
 
-  pthread_exit(NULL);
+/* prints the online figure against the offline schedule and bound */
+static void offline_print(const char *what, double online)
+{
+  double best = (double)offline.best / MSEC_PER_SEC;
+  double bound = (double)offline.open_bound / MSEC_PER_SEC;
+  char best_s[24];
+  char bound_s[24];
+
+  ms_string(best_s, sizeof(best_s), offline.best);
+  ms_string(bound_s, sizeof(bound_s), offline.open_bound);
+  if (offline.best == INT64_MAX) {
+    printf("Offline %s: nothing found in %ld nodes, at least %s s; online %.3f s\n", what,
+           offline.nodes, bound_s, online);
+    return;
+  }
+  if (offline.open_bound == offline.best) {
+    printf("Offline %s: %s s, optimal (%ld nodes); online %.3f s, %.1f%% above\n", what, best_s,
+           offline.nodes, online, best > 0 ? 100.0 * (online - best) / best : 0.0);
+    return;
+  }
+  printf("Offline %s: %s s found, at least %s s (%ld nodes); online %.3f s, "
+         "%.1f%% above the schedule found, at most %.1f%% above the best possible\n", what, best_s,
+         bound_s, offline.nodes, online, best > 0 ? 100.0 * (online - best) / best : 0.0,
+         bound > 0 ? 100.0 * (online - bound) / bound : 0.0);
+}
+
+/* 
+* Function: offline_report
+* Parameters: budget - nodes each search may expand
+* Returns: int - 0 on success, 1 if the run cannot be compared
+* Description: reads the trace of the run that just finished again, searches
+*              the best makespan and the least total wait under the rules and
+*              prints the online run's gap to both. Call after the run, while
+*              the trace is still open.
+ */
+/* gives back the trace copy offline_report() searches, whichever arrays it got */
+static void offline_free(void)
+{
+  free(offline.arrival);
+  free(offline.runway_time);
+  free(offline.type);
+  free(offline.done);
+  offline.arrival = NULL;
+  offline.runway_time = NULL;
+  offline.type = NULL;
+  offline.done = NULL;
+}
+
+static int offline_report(long budget)
+{
+  size_t pos = trace.binary ? TRACE_HEADER_SIZE : 0;
+  const runway_stats *total = stats_total();
+  int64_t online_wait = 0;
+  int type, arrival_time, runway_time;
+  int64_t now = 0;
+  int n = 0;
+
+  if (num_runways != 1) {
+    printf("Offline bound: only for a single runway\n");
+    return 1;
+  }
+  offline.arrival = malloc(OFFLINE_MAX_AIRCRAFT * sizeof(int64_t));
+  offline.runway_time = malloc(OFFLINE_MAX_AIRCRAFT * sizeof(int));
+  offline.type = malloc(OFFLINE_MAX_AIRCRAFT * sizeof(int));
+  offline.done = malloc(OFFLINE_MAX_AIRCRAFT);
+  if (offline.arrival == NULL || offline.runway_time == NULL || offline.type == NULL
+      || offline.done == NULL) {
+    printf("runway: out of memory for the offline search\n");
+    offline_free();
+    return 1;
+  }
+  while (trace_decode(&pos, &type, &arrival_time, &runway_time)) {
+    if (n == OFFLINE_MAX_AIRCRAFT) {
+      printf("Offline bound: only for traces of up to %d aircraft\n", OFFLINE_MAX_AIRCRAFT);
+      offline_free();
+      return 1;
+    }
+    now = now + arrival_time;
+    offline.arrival[n] = now;
+    offline.runway_time[n] = runway_time;
+    offline.type[n] = type;
+    n = n + 1;
+  }
+  offline.n = n;
+  for (type = COMMERCIAL; type <= EMERGENCY; type++) {
+    online_wait = online_wait + total->wait[type].sum;
+  }
+
+  offline.deadlines = 1;
+  if (!offline_solve(OFFLINE_MAKESPAN, budget)) {
+    printf("Offline bound: no schedule admits every emergency within %d s, "
+           "searching without that rule\n", EMERGENCY_TIMEOUT);
+    offline.deadlines = 0;
+    offline_solve(OFFLINE_MAKESPAN, budget);
+  }
+  offline_print("makespan", seconds(total->last_cleared));
+  offline_solve(OFFLINE_WAIT, budget);
+  offline_print("total wait", seconds(online_wait));
+
+  offline_free();
+  return 0;
+}
+
+/* nonzero if text is a -S seed: decimal digits only, no more than an unsigned holds */
+static int seed_valid(const char *text)
+{
+  char *end;
+  unsigned long value;
+
+  if (text[0] < '0' || text[0] > '9') {
+    return 0;
+  }
+  errno = 0;
+  value = strtoul(text, &end, 10);
+  return *end == '\0' && errno != ERANGE && value <= (unsigned)-1;
 }
 
 /* Main function sets up simulation and prints report
@@ -641,78 +5774,372 @@ void* emergency_aircraft(void *ai_ptr)
  */
 int main(int nargs, char **args) 
 {
-  int i;
+  int opt;
   int result;
   int num_aircraft;
+  int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
   void *status;
-  pthread_t controller_tid;
-  pthread_t aircraft_tid[MAX_AIRCRAFT];
-  aircraft_info ai[MAX_AIRCRAFT];
+  pthread_t aircraft_tid;
+  pthread_attr_t detached;
+  aircraft_info *ai;
+  int64_t arrival_due = 0;
+  char *convert_to = NULL;
+  char *event_log_to = NULL;
+  char *timeline_to = NULL;
+  long offline_budget = 0;
+  char *replay_from = NULL;
+  char *stats_to = NULL;
+  char *record_to = NULL;
+  char *decisions_from = NULL;
+  const sched_policy *base_policy = &policies[0];
+  int (*should_switch)(const runway *rw) = NULL;
+  int (*should_break)(const runway *rw, int switching) = NULL;
+
+  sim_seed = (unsigned)time(NULL);
+  while ((opt = getopt(nargs, args, "m:j:n:p:w:s:d:b:f:c:l:r:T:J:M:S:R:P:O:H:A:")) != -1) 
+  {
+    if (opt == 'm' && strcmp(optarg, "threads") == 0) 
+    {
+      sim_mode = MODE_THREADS;
+    }
+    else if (opt == 'm' && strcmp(optarg, "virtual") == 0) 
+    {
+      sim_mode = MODE_VIRTUAL;
+    }
+    else if (opt == 'm' && strcmp(optarg, "pool") == 0) 
+    {
+      sim_mode = MODE_POOL;
+    }
+    else if (opt == 'j' && atoi(optarg) > 0) 
+    {
+      workers = atoi(optarg);
+    }
+    else if (opt == 'n' && atoi(optarg) > 0 && atoi(optarg) <= MAX_RUNWAYS) 
+    {
+      num_runways = atoi(optarg);
+    }
+    else if (opt == 'p' && param_parse(optarg)) 
+    {
+      // recorded by param_parse(): a new value, or a range to sweep
+    }
+    else if (opt == 'w' && strcmp(optarg, "targeted") == 0) 
+    {
+      wakeup_mode = WAKE_TARGETED;
+    }
+    else if (opt == 'w' && strcmp(optarg, "broadcast") == 0) 
+    {
+      wakeup_mode = WAKE_BROADCAST;
+    }
+    else if (opt == 's' && policy_find(optarg) != NULL) 
+    {
+      base_policy = policy_find(optarg);
+    }
+    else if (opt == 'd' && strcmp(optarg, "limits") == 0) 
+    {
+      should_switch = switch_on_limits;
+    }
+    else if (opt == 'd' && strcmp(optarg, "plan") == 0) 
+    {
+      should_switch = switch_on_plan;
+    }
+    else if (opt == 'b' && strcmp(optarg, "due") == 0) 
+    {
+      should_break = break_when_due;
+    }
+    else if (opt == 'b' && strcmp(optarg, "early") == 0) 
+    {
+      should_break = break_early;
+    }
+    else if (opt == 'f' && strcmp(optarg, "none") == 0) 
+    {
+      pack_mode = PACK_NONE;
+    }
+    else if (opt == 'f' && strcmp(optarg, "fill") == 0) 
+    {
+      pack_mode = PACK_FILL;
+    }
+    else if (opt == 'c') 
+    {
+      convert_to = optarg;
+    }
+    else if (opt == 'l') 
+    {
+      event_log_to = optarg;
+    }
+    else if (opt == 'r') 
+    {
+      replay_from = optarg;
+    }
+    else if (opt == 'T') 
+    {
+      timeline_to = optarg;
+    }
+    else if (opt == 'J') 
+    {
+      stats_to = optarg;
+    }
+    else if (opt == 'M') 
+    {
+      metrics.name = optarg;
+    }
+    else if (opt == 'A') 
+    {
+      server.name = optarg;
+    }
+    else if (opt == 'H' && optarg[0] >= '0' && optarg[0] <= '9') 
+    {
+      holding_depth = atoi(optarg);
+    }
+    else if (opt == 'O' && atol(optarg) > 0) 
+    {
+      offline_budget = atol(optarg);
+    }
+    else if (opt == 'S' && seed_valid(optarg)) 
+    {
+      sim_seed = (unsigned)strtoul(optarg, NULL, 10);
+    }
+    else if (opt == 'R') 
+    {
+      record_to = optarg;
+    }
+    else if (opt == 'P') 
+    {
+      decisions_from = optarg;
+    }
+    else 
+    {
+      optind = nargs; // force the usage message below
+      break;
+    }
+  }
+
+  // -d and -b replace that part of the policy -s chose, whatever the order given
+  policy = *base_policy;
+  if (should_switch != NULL) 
+  {
+    policy.should_switch = should_switch;
+  }
+  if (should_break != NULL) 
+  {
+    policy.should_break = should_break;
+  }
+
+  if (replay_from != NULL && optind == nargs) 
+  {
+    return log_replay(replay_from, timeline_to);
+  }
+
+  // the clients bring the aircraft, so there is nothing to record, replay or search
+  if (server.name != NULL && optind == nargs) 
+  {
+    if (convert_to != NULL || record_to != NULL || decisions_from != NULL || offline_budget > 0
+        || sweep_requested()) 
+    {
+      printf("runway: -A cannot be combined with -c, -R, -P, -O or a sweep\n");
+      return EINVAL;
+    }
+    return server_run(event_log_to, timeline_to, stats_to);
+  }
+
+  if (optind != nargs - 1) 
+  {
+    printf("Usage: runway [-m threads|virtual|pool] [-j workers] [-n runways]\n"
+           "              [-p parameter=value|lo-hi[:step]] ... [-w targeted|broadcast]\n"
+           "              [-s fifo|edf] [-d limits|plan] [-b due|early] [-f none|fill]\n"
+           "              [-H holding-stack-depth]\n"
+           "              [-c binary-trace-to-write] [-l event-log-to-write]\n"
+           "              [-T timeline-json-to-write]\n"
+           "              [-J statistics-json-to-write] [-M shared-memory-name]\n"
+           "              [-S seed] [-R decisions-to-record] [-P decisions-to-replay]\n"
+           "              [-O offline-search-nodes]\n"
+           "              <name of inputfile>\n"
+           "       runway -A shared-memory-name [-n runways] [-p parameter=value] ...\n"
+           "              [-s, -d, -b, -f, -H, -l, -T, -J and -M as above]\n"
+           "       runway -r event-log-to-print [-T timeline-json-to-write]\n");
+    return EINVAL;
+  }
 
-  if (nargs != 2) 
+  // the record's seed, runways and parameters replace those given here
+  if (decisions_from != NULL && decisions_replay(decisions_from) != 0) 
+  {
+    return 1;
+  }
+  if ((decisions_from != NULL || record_to != NULL) && sweep_requested()) 
   {
-    printf("Usage: runway <name of inputfile>\n");
+    printf("runway: a sweep cannot record or replay decisions\n");
     return EINVAL;
   }
 
-  num_aircraft = initialize(ai, args[1]);
-  if (num_aircraft > MAX_AIRCRAFT || num_aircraft <= 0) 
+  num_aircraft = initialize(args[optind]);
+  if (convert_to != NULL) 
+  {
+    result = trace_convert(convert_to, num_aircraft);
+    trace_close();
+    return result;
+  }
+  if (num_aircraft <= 0) 
   {
     printf("Error:  Bad number of aircraft threads. "
            "Maybe there was a problem with your input file?\n");
     return 1;
   }
 
-  printf("Starting runway simulation with %d aircraft ...\n", num_aircraft);
+  if (decisions_from != NULL && num_aircraft != decisions.aircraft) 
+  {
+    printf("runway: %s was recorded on a trace of %d aircraft, not %d\n", decisions_from,
+           decisions.aircraft, num_aircraft);
+    return 1;
+  }
 
-  result = pthread_create(&controller_tid, NULL, controller_thread, NULL);
+  if (workers < 1) 
+  {
+    workers = 1;
+  }
 
-  if (result) 
+  if (sweep_requested()) 
   {
-    printf("runway:  pthread_create failed for controller: %s\n", strerror(result));
-    exit(1);
+    trace_close();
+    return sweep_run(args[optind], workers);
+  }
+
+  if (num_runways > 1) 
+  {
+    printf("Starting runway simulation with %d aircraft on %d runways (seed %u) ...\n",
+           num_aircraft, num_runways, sim_seed);
+  }
+  else 
+  {
+    printf("Starting runway simulation with %d aircraft (seed %u) ...\n", num_aircraft, sim_seed);
+  }
+
+  if (record_to != NULL && decisions_record(record_to, num_aircraft) != 0) 
+  {
+    return 1;
+  }
+
+  sim_epoch = monotonic_ns();
+  log_start(event_log_to, timeline_to);
+  if (metrics_start() != 0) 
+  {
+    return 1;
+  }
+
+  if (sim_mode != MODE_THREADS) 
+  {
+    result = engine_run(sim_mode, workers);
+    log_stop();
+    metrics_stop();
+    decisions_finish();
+    if (result == 0) 
+    {
+      print_deadline_report();
+      result = print_stats(stats_to);
+      if (offline_budget > 0) 
+      {
+        result = offline_report(offline_budget) || result;
+      }
+      printf("Runway simulation done.\n");
+    }
+    else 
+    {
+      printf("runway: simulation stalled with %d aircraft still waiting\n", result);
+      result = 1;
+    }
+    arena_destroy();
+    trace_close();
+    return result;
+  }
+
+  for (int i = 0; i < num_runways; i++) 
+  {
+    result = pthread_create(&runways[i].controller_tid, NULL, controller_thread, &runways[i]);
+
+    if (result) 
+    {
+      printf("runway:  pthread_create failed for controller: %s\n", strerror(result));
+      exit(1);
+    }
   }
 
-  for (i=0; i < num_aircraft; i++) 
+  /* aircraft threads are detached and hand their record back when done */
+  pthread_attr_init(&detached);
+  pthread_attr_setdetachstate(&detached, PTHREAD_CREATE_DETACHED);
+
+  for (;;) 
   {
-    ai[i].aircraft_id = i;
-    sleep(ai[i].arrival_time);
+    lock_acquire(&lock);
+    ai = trace_next();
+    lock_release(&lock);
+    if (ai == NULL) 
+    {
+      break;
+    }
+
+    /* due times are absolute, so time spent creating threads does not accumulate */
+    arrival_due = arrival_due + (int64_t)ai->arrival_time * NSEC_PER_MSEC;
+    sleep_until(sim_epoch + arrival_due);
                 
-    if (ai[i].aircraft_type == COMMERCIAL)
+    if (ai->aircraft_type == COMMERCIAL)
     {
-      result = pthread_create(&aircraft_tid[i], NULL, commercial_aircraft, 
-                             (void *)&ai[i]);
+      result = pthread_create(&aircraft_tid, &detached, commercial_aircraft, 
+                             (void *)ai);
     }
-    else if (ai[i].aircraft_type == CARGO)
+    else if (ai->aircraft_type == CARGO)
     {
-      result = pthread_create(&aircraft_tid[i], NULL, cargo_aircraft, 
-                             (void *)&ai[i]);
+      result = pthread_create(&aircraft_tid, &detached, cargo_aircraft, 
+                             (void *)ai);
     }
     else 
     {
-      result = pthread_create(&aircraft_tid[i], NULL, emergency_aircraft, 
-                             (void *)&ai[i]);
+      result = pthread_create(&aircraft_tid, &detached, emergency_aircraft, 
+                             (void *)ai);
     }
 
     if (result) 
     {
       printf("runway: pthread_create failed for aircraft %d: %s\n", 
-            i, strerror(result));
+            ai->aircraft_id, strerror(result));
       exit(1);
     }
   }
+  pthread_attr_destroy(&detached);
 
   /* wait for all aircraft threads to finish */
-  for (i = 0; i < num_aircraft; i++) 
+  lock_acquire(&lock);
+  while (arena.in_flight > 0) 
   {
-    pthread_join(aircraft_tid[i], &status);
+    lock_wait(&lock, &cond_released, NULL);
   }
+  lock_release(&lock);
 
-  /* tell the controller to finish. */
-  pthread_cancel(controller_tid);
-  pthread_join(controller_tid, &status);
+  /* tell the controllers to finish. */
+  for (int i = 0; i < num_runways; i++) 
+  {
+    lock_acquire(&runways[i].lock);
+    simulation_done = 1;
+    controller_poke(&runways[i]);
+    lock_release(&runways[i].lock);
+  }
+  for (int i = 0; i < num_runways; i++) 
+  {
+    pthread_join(runways[i].controller_tid, &status);
+  }
+  log_stop();
+  metrics_stop();
+  decisions_finish();
+
+  printf("Aircraft wakeups: %lu (%lu spurious), %lu aircraft admitted without waiting\n",
+         stats_total()->wakeups, stats_total()->spurious, stats_total()->fast);
+  print_deadline_report();
+  result = print_stats(stats_to);
+  if (offline_budget > 0) 
+  {
+    result = offline_report(offline_budget) || result;
+  }
 
   printf("Runway simulation done.\n");
 
-  return 0;
+  arena_destroy();
+  trace_close();
+  return result;
 }
@@ -0,0 +1,214 @@
+/* Synthetic workload generator for the runway simulation.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILTY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/license/>.
+*/
+
+/* Writes a trace in the test-cases text format ("type delay runway_time" per
+ * line) to stdout. Arrivals are either a Poisson process or bursts of aircraft
+ * arriving together with Poisson-distributed gaps between bursts; the mean
+ * arrival rate is the same either way. The aircraft type mix and the runway
+ * time distribution are configurable, and the same seed always gives the same
+ * trace. Times are whole seconds unless -d asks for decimals, down to the
+ * millisecond.
+ */
+
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define ARRIVAL_POISSON 0        /* Exponential gaps between single aircraft */
+#define ARRIVAL_BURSTY  1        /* Bursts of aircraft arriving back to back */
+
+#define RUNWAY_FIXED       0     /* Every aircraft needs runway_a seconds */
+#define RUNWAY_UNIFORM     1     /* Uniform between runway_a and runway_b seconds */
+#define RUNWAY_EXPONENTIAL 2     /* Exponential with mean runway_a, at least one time unit */
+
+typedef struct
+{
+  long count;              // aircraft to generate
+  int arrivals;            // ARRIVAL_*
+  double mean_gap;         // mean seconds between aircraft
+  int burst;               // aircraft per burst for ARRIVAL_BURSTY
+  double mix[3];           // relative weights of commercial, cargo, emergency
+  int runway;              // RUNWAY_*
+  double runway_a;
+  double runway_b;
+  uint64_t seed;
+  int decimals;            // digits after the decimal point in the times written, 0 to 3
+} workload;
+
+static uint64_t rng_state;
+
+/* xorshift64*, so traces do not depend on the C library's rand() */
+static double rng_uniform(void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return (double)((rng_state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static double rng_exponential(double mean)
+{
+  return -mean * log(1.0 - rng_uniform());
+}
+
+/* rounds a non-negative number of seconds to whole units, carrying the remainder */
+static double round_to(double seconds, double unit, double *carry)
+{
+  double total = seconds + *carry;
+  double rounded = floor(total / unit + 0.5) * unit;
+
+  *carry = total - rounded;
+  return rounded;
+}
+
+static int pick_type(const workload *w)
+{
+  double total = w->mix[0] + w->mix[1] + w->mix[2];
+  double x = rng_uniform() * total;
+
+  if (x < w->mix[0]) {
+    return 0;
+  }
+  return x < w->mix[0] + w->mix[1] ? 1 : 2;
+}
+
+static double pick_runway_time(const workload *w, double unit)
+{
+  double t;
+
+  if (w->runway == RUNWAY_FIXED) {
+    t = w->runway_a;
+  } else if (w->runway == RUNWAY_UNIFORM) {
+    t = floor((w->runway_a + rng_uniform() * (w->runway_b - w->runway_a + unit)) / unit) * unit;
+  } else {
+    t = floor(rng_exponential(w->runway_a) / unit + 0.5) * unit;
+  }
+  return t < unit ? unit : t;
+}
+
+/*
+* Function: generate
+* Parameters: w - workload description
+*             out - where the trace goes
+* Returns: void
+* Description: writes the trace. Delays are rounded to the time unit the
+*              decimals allow; the rounding error is carried to the next
+*              aircraft so the mean rate stays exact over the trace.
+ */
+static void generate(const workload *w, FILE *out)
+{
+  double carry = 0.0;
+  double unit = pow(10.0, -w->decimals);
+
+  rng_state = w->seed ? w->seed : 1;
+  fprintf(out, "# generated: %ld aircraft, %s arrivals, mean gap %.3fs, mix %g:%g:%g, seed %llu\n",
+          w->count, w->arrivals == ARRIVAL_POISSON ? "poisson" : "bursty", w->mean_gap,
+          w->mix[0], w->mix[1], w->mix[2], (unsigned long long)w->seed);
+
+  for (long i = 0; i < w->count; i++) {
+    double delay = 0.0;
+    double runway_time;
+    int type;
+
+    if (i > 0 && w->arrivals == ARRIVAL_POISSON) {
+      delay = round_to(rng_exponential(w->mean_gap), unit, &carry);
+    } else if (i > 0 && i % w->burst == 0) {
+      delay = round_to(rng_exponential(w->mean_gap * w->burst), unit, &carry);
+    }
+    // runway time before type: the order traces have always drawn them in
+    runway_time = pick_runway_time(w, unit);
+    type = pick_type(w);
+    fprintf(out, "%d %.*f %.*f\n", type, w->decimals, delay, w->decimals, runway_time);
+  }
+}
+
+/* parses "poisson" or "bursty[:N]" */
+static int parse_arrivals(const char *arg, workload *w)
+{
+  if (strcmp(arg, "poisson") == 0) {
+    w->arrivals = ARRIVAL_POISSON;
+    return 1;
+  }
+  if (strncmp(arg, "bursty", 6) == 0) {
+    w->arrivals = ARRIVAL_BURSTY;
+    return arg[6] == '\0' || (arg[6] == ':' && (w->burst = atoi(arg + 7)) > 0);
+  }
+  return 0;
+}
+
+/* parses "fixed:N", "uniform:A-B" or "exp:MEAN" */
+static int parse_runway(const char *arg, workload *w)
+{
+  if (sscanf(arg, "fixed:%lf", &w->runway_a) == 1) {
+    w->runway = RUNWAY_FIXED;
+    return w->runway_a >= 1;
+  }
+  if (sscanf(arg, "uniform:%lf-%lf", &w->runway_a, &w->runway_b) == 2) {
+    w->runway = RUNWAY_UNIFORM;
+    return w->runway_a >= 1 && w->runway_b >= w->runway_a;
+  }
+  if (sscanf(arg, "exp:%lf", &w->runway_a) == 1) {
+    w->runway = RUNWAY_EXPONENTIAL;
+    return w->runway_a > 0;
+  }
+  return 0;
+}
+
+int main(int nargs, char **args)
+{
+  workload w = { 1000, ARRIVAL_POISSON, 6.0, 4, { 45, 45, 10 }, RUNWAY_UNIFORM, 1, 5, 1, 0 };
+  int opt;
+  int ok = 1;
+
+  while (ok && (opt = getopt(nargs, args, "n:a:g:m:r:s:d:")) != -1) {
+    if (opt == 'n') {
+      ok = (w.count = atol(optarg)) > 0;
+    } else if (opt == 'a') {
+      ok = parse_arrivals(optarg, &w);
+    } else if (opt == 'g') {
+      ok = (w.mean_gap = atof(optarg)) > 0;
+    } else if (opt == 'm') {
+      ok = sscanf(optarg, "%lf:%lf:%lf", &w.mix[0], &w.mix[1], &w.mix[2]) == 3
+           && w.mix[0] >= 0 && w.mix[1] >= 0 && w.mix[2] >= 0
+           && w.mix[0] + w.mix[1] + w.mix[2] > 0;
+    } else if (opt == 'r') {
+      ok = parse_runway(optarg, &w);
+    } else if (opt == 's') {
+      w.seed = strtoull(optarg, NULL, 10);
+    } else if (opt == 'd') {
+      w.decimals = atoi(optarg);
+      ok = w.decimals >= 0 && w.decimals <= 3;
+    } else {
+      ok = 0;
+    }
+  }
+
+  if (!ok || optind != nargs) {
+    printf("Usage: workload [-n aircraft] [-a poisson|bursty[:N]] [-g mean-gap-seconds]\n"
+           "                [-m commercial:cargo:emergency] [-r fixed:N|uniform:A-B|exp:MEAN]\n"
+           "                [-s seed] [-d decimals]\n");
+    return EINVAL;
+  }
+
+  generate(&w, stdout);
+  return 0;
+}